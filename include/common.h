@@ -7,12 +7,13 @@
 #include <string>
 #include <fstream>
 #include <sstream>
+#include <learnopengl/vfs.h>
 
-std::string readFileContents(std::string path) {
-    std::ifstream in(path);
-    std::stringstream buffer;
-    buffer << in.rdbuf();
-    return buffer.str();
+// reads through the VirtualFileSystem; empty if the file does not exist.
+inline std::string readFileContents(std::string path) {
+    std::string contents;
+    VirtualFileSystem::Instance().Read(path, contents);
+    return contents;
 }
 
 
@@ -0,0 +1,55 @@
+#ifndef ASSET_CACHE_H
+#define ASSET_CACHE_H
+
+#include <sys/stat.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+using namespace std;
+
+// helpers shared by the on-disk caches of processed assets (meshes, compressed textures).
+
+const char ASSET_CACHE_DIRECTORY[] = "resources/cache";
+
+// FNV-1a, used to turn a source path into a cache file name.
+inline uint64_t AssetCacheHash(const void *bytes, size_t length, uint64_t hash = 1469598103934665603ull)
+{
+    const unsigned char *data = (const unsigned char *)bytes;
+    for (size_t i = 0; i < length; i++)
+    {
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+inline uint64_t AssetCacheHash(const string &text)
+{
+    return AssetCacheHash(text.data(), text.size());
+}
+
+// modification time (in nanoseconds) and size of a source file, used to invalidate cache entries.
+inline bool AssetCacheStat(const string &path, int64_t &mtime, uint64_t &size)
+{
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0)
+        return false;
+    mtime = (int64_t)info.st_mtim.tv_sec * 1000000000ll + info.st_mtim.tv_nsec;
+    size = (uint64_t)info.st_size;
+    return true;
+}
+
+// path of the cache entry for sourcePath; extension identifies the kind of cache.
+inline string AssetCachePath(const string &sourcePath, const char *extension)
+{
+    char name[48];
+    snprintf(name, sizeof(name), "%016llx.%s", (unsigned long long)AssetCacheHash(sourcePath), extension);
+    return string(ASSET_CACHE_DIRECTORY) + '/' + name;
+}
+
+inline void AssetCacheCreateDirectory()
+{
+    mkdir(ASSET_CACHE_DIRECTORY, 0755);
+}
+#endif
@@ -0,0 +1,390 @@
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+
+#include <learnopengl/asset_cache.h>
+#include <learnopengl/thread_pool.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Single-file archive of an asset tree, memory mapped by the VirtualFileSystem (see vfs.h). Layout:
+//   AssetPackHeader
+//   AssetPackEntry[entryCount]    sorted by path
+//   uint32_t[bucketCount]         open addressing hash table over the paths: entry index + 1, 0 when empty
+//   path strings
+//   entry data, each entry aligned so uncompressed data can be used in place
+// Entries that shrink enough are stored compressed with a small LZ77 codec (LZ4 block style), which decodes
+// at memory speed; images are already compressed and stay as they are.
+
+const uint32_t ASSET_PACK_VERSION = 1;
+const uint64_t ASSET_PACK_ALIGNMENT = 16;
+// entries are only stored compressed if that saves at least this fraction of their size
+const float ASSET_PACK_MIN_SAVING = 0.1f;
+
+enum class AssetPackCompression : uint32_t { None = 0, Lz = 1 };
+
+struct AssetPackHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t bucketCount;
+    uint64_t entriesOffset;
+    uint64_t bucketsOffset;
+    uint64_t stringsOffset;
+};
+
+struct AssetPackEntry {
+    uint64_t hash;        // AssetCacheHash of the path
+    uint64_t dataOffset;
+    uint64_t size;        // uncompressed
+    uint64_t storedSize;  // in the pack
+    int64_t mtime;        // of the source file when the pack was built, see AssetCacheStat
+    uint64_t pathOffset;
+    uint32_t pathLength;
+    AssetPackCompression compression;
+};
+
+// --- LZ codec --------------------------------------------------------------------------------------------------
+// sequences of [token: literal count << 4 | match length - 4][extra literal count][literals][offset:16][extra
+// match length], counts of 15 continue in 255-saturated bytes; the last sequence only has literals.
+
+const size_t LZ_MIN_MATCH = 4;
+const unsigned int LZ_HASH_BITS = 16;
+
+inline void lzWriteLength(vector<unsigned char> &out, size_t length)
+{
+    for (; length >= 255; length -= 255)
+        out.push_back(255);
+    out.push_back((unsigned char)length);
+}
+
+inline vector<unsigned char> LzCompress(const unsigned char *data, size_t size)
+{
+    vector<unsigned char> out;
+    out.reserve(size / 2 + 16);
+    vector<uint32_t> table(1u << LZ_HASH_BITS, UINT32_MAX);
+    auto hashAt = [data](size_t i) {
+        uint32_t value;
+        memcpy(&value, data + i, 4);
+        return (value * 2654435761u) >> (32 - LZ_HASH_BITS);
+    };
+    size_t anchor = 0, i = 0;
+    while (i + LZ_MIN_MATCH <= size)
+    {
+        uint32_t &slot = table[hashAt(i)];
+        size_t candidate = slot;
+        slot = (uint32_t)i;
+        if (candidate == UINT32_MAX || i - candidate > 0xFFFF || memcmp(data + candidate, data + i, LZ_MIN_MATCH) != 0)
+        {
+            i++;
+            continue;
+        }
+        size_t length = LZ_MIN_MATCH;
+        while (i + length < size && data[candidate + length] == data[i + length])
+            length++;
+        size_t literals = i - anchor;
+        out.push_back((unsigned char)(std::min<size_t>(literals, 15) << 4 | std::min<size_t>(length - LZ_MIN_MATCH, 15)));
+        if (literals >= 15)
+            lzWriteLength(out, literals - 15);
+        out.insert(out.end(), data + anchor, data + i);
+        size_t offset = i - candidate;
+        out.push_back((unsigned char)(offset & 0xFF));
+        out.push_back((unsigned char)(offset >> 8));
+        if (length - LZ_MIN_MATCH >= 15)
+            lzWriteLength(out, length - LZ_MIN_MATCH - 15);
+        i += length;
+        anchor = i;
+    }
+    size_t literals = size - anchor;
+    out.push_back((unsigned char)(std::min<size_t>(literals, 15) << 4));
+    if (literals >= 15)
+        lzWriteLength(out, literals - 15);
+    out.insert(out.end(), data + anchor, data + size);
+    return out;
+}
+
+// decodes into out, which must hold exactly the uncompressed size. Returns false on malformed input.
+inline bool LzDecompress(const unsigned char *in, size_t inSize, unsigned char *out, size_t outSize)
+{
+    const unsigned char *inEnd = in + inSize;
+    unsigned char *o = out, *outEnd = out + outSize;
+    auto readLength = [&in, inEnd](size_t &length) {
+        unsigned char byte;
+        do
+        {
+            if (in == inEnd)
+                return false;
+            byte = *in++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    };
+    while (in < inEnd)
+    {
+        unsigned char token = *in++;
+        size_t literals = token >> 4;
+        if (literals == 15 && !readLength(literals))
+            return false;
+        if ((size_t)(inEnd - in) < literals || (size_t)(outEnd - o) < literals)
+            return false;
+        memcpy(o, in, literals);
+        in += literals;
+        o += literals;
+        if (in == inEnd)
+            break; // last sequence
+        if (inEnd - in < 2)
+            return false;
+        size_t offset = in[0] | (size_t)in[1] << 8;
+        in += 2;
+        size_t length = token & 15;
+        if (length == 15 && !readLength(length))
+            return false;
+        length += LZ_MIN_MATCH;
+        if (offset == 0 || offset > (size_t)(o - out) || (size_t)(outEnd - o) < length)
+            return false;
+        // byte by byte, matches may overlap the bytes they produce
+        const unsigned char *match = o - offset;
+        for (size_t k = 0; k < length; k++)
+            o[k] = match[k];
+        o += length;
+    }
+    return o == outEnd;
+}
+
+// --- reading ---------------------------------------------------------------------------------------------------
+
+// Read-only memory mapping of a validated pack. Entry data pointers stay valid until the object is destroyed.
+class AssetPack
+{
+public:
+    AssetPack() : data(nullptr), size(0) {}
+    ~AssetPack() { close(); }
+    AssetPack(const AssetPack &) = delete;
+    AssetPack &operator=(const AssetPack &) = delete;
+
+    bool open(const string &packPath)
+    {
+        close();
+        int fd = ::open(packPath.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat info;
+        if (fstat(fd, &info) != 0 || (uint64_t)info.st_size < sizeof(AssetPackHeader))
+        {
+            ::close(fd);
+            return false;
+        }
+        size = (size_t)info.st_size;
+        void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED)
+        {
+            size = 0;
+            return false;
+        }
+        data = (const char *)mapping;
+
+        const AssetPackHeader &h = header();
+        bool valid = memcmp(h.magic, "LPK1", 4) == 0
+                     && h.version == ASSET_PACK_VERSION
+                     && h.bucketCount > 0 && (h.bucketCount & (h.bucketCount - 1)) == 0
+                     && h.entriesOffset + (uint64_t)h.entryCount * sizeof(AssetPackEntry) <= size
+                     && h.bucketsOffset + (uint64_t)h.bucketCount * sizeof(uint32_t) <= size
+                     && h.stringsOffset <= size;
+        for (uint32_t i = 0; valid && i < h.entryCount; i++)
+        {
+            const AssetPackEntry &e = entry(i);
+            valid = e.pathOffset + e.pathLength <= size && e.dataOffset + e.storedSize <= size
+                    && (e.compression == AssetPackCompression::None ? e.storedSize == e.size : e.compression == AssetPackCompression::Lz);
+        }
+        if (!valid)
+        {
+            cout << "ERROR::ASSET_PACK:: " << packPath << " is not a valid asset pack" << endl;
+            close();
+        }
+        return valid;
+    }
+
+    void close()
+    {
+        if (data)
+            munmap((void *)data, size);
+        data = nullptr;
+        size = 0;
+    }
+
+    const AssetPackHeader &header() const { return *(const AssetPackHeader *)data; }
+    unsigned int entryCount() const { return header().entryCount; }
+    const AssetPackEntry &entry(unsigned int i) const { return ((const AssetPackEntry *)(data + header().entriesOffset))[i]; }
+    string path(const AssetPackEntry &e) const { return string(data + e.pathOffset, e.pathLength); }
+    const char *contents(const AssetPackEntry &e) const { return data + e.dataOffset; }
+
+    // the entry of a normalized path (see VirtualFileSystem::Normalize), nullptr if the pack does not have it.
+    const AssetPackEntry *find(const string &path) const
+    {
+        const AssetPackHeader &h = header();
+        const uint32_t *buckets = (const uint32_t *)(data + h.bucketsOffset);
+        uint64_t hash = AssetCacheHash(path);
+        for (uint32_t probe = 0, bucket = (uint32_t)hash & (h.bucketCount - 1); probe < h.bucketCount;
+             probe++, bucket = (bucket + 1) & (h.bucketCount - 1))
+        {
+            if (buckets[bucket] == 0 || buckets[bucket] > h.entryCount)
+                return nullptr;
+            const AssetPackEntry &e = entry(buckets[bucket] - 1);
+            if (e.hash == hash && e.pathLength == path.size() && memcmp(data + e.pathOffset, path.data(), path.size()) == 0)
+                return &e;
+        }
+        return nullptr;
+    }
+
+private:
+    const char *data;
+    size_t size;
+};
+
+// --- writing ---------------------------------------------------------------------------------------------------
+
+inline void assetPackCollect(const string &directory, vector<string> &files)
+{
+    DIR *dir = opendir(directory.c_str());
+    if (!dir)
+        return;
+    while (dirent *entry = readdir(dir))
+    {
+        string name = entry->d_name;
+        if (name == "." || name == "..")
+            continue;
+        string path = directory + '/' + name;
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0)
+            continue;
+        // the caches are derived data, written at runtime next to the pack
+        if (S_ISDIR(info.st_mode) && path != ASSET_CACHE_DIRECTORY)
+            assetPackCollect(path, files);
+        else if (S_ISREG(info.st_mode))
+            files.push_back(path);
+    }
+    closedir(dir);
+}
+
+// packs every file under directory (except the asset caches) into packPath; entries are named by their path
+// relative to the working directory, the way the application refers to them. Files are read and compressed
+// on the loader pool. The pack is written under a temporary name and renamed into place.
+inline bool WriteAssetPack(const string &directory, const string &packPath, bool compress = true)
+{
+    vector<string> files;
+    assetPackCollect(directory, files);
+    sort(files.begin(), files.end());
+
+    struct Packed {
+        AssetPackEntry entry;
+        vector<unsigned char> contents;
+        bool ok = false;
+    };
+    vector<Packed> packed(files.size());
+    ThreadPool::Loaders().ParallelFor(files.size(), [&](size_t i) {
+        Packed &p = packed[i];
+        memset(&p.entry, 0, sizeof(p.entry));
+        ifstream in(files[i], ios::binary);
+        uint64_t sourceSize;
+        if (!in || !AssetCacheStat(files[i], p.entry.mtime, sourceSize))
+            return;
+        p.contents.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+        p.entry.hash = AssetCacheHash(files[i]);
+        p.entry.size = p.entry.storedSize = p.contents.size();
+        p.entry.compression = AssetPackCompression::None;
+        if (compress && !p.contents.empty())
+        {
+            vector<unsigned char> compressed = LzCompress(p.contents.data(), p.contents.size());
+            if (compressed.size() <= p.contents.size() * (1.0f - ASSET_PACK_MIN_SAVING))
+            {
+                p.contents.swap(compressed);
+                p.entry.storedSize = p.contents.size();
+                p.entry.compression = AssetPackCompression::Lz;
+            }
+        }
+        p.ok = true;
+    });
+
+    AssetPackHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "LPK1", 4);
+    header.version = ASSET_PACK_VERSION;
+    header.entryCount = (uint32_t)files.size();
+    header.bucketCount = 1;
+    while (header.bucketCount < header.entryCount * 2)
+        header.bucketCount *= 2;
+    header.entriesOffset = sizeof(AssetPackHeader);
+    header.bucketsOffset = header.entriesOffset + files.size() * sizeof(AssetPackEntry);
+    header.stringsOffset = header.bucketsOffset + header.bucketCount * sizeof(uint32_t);
+
+    vector<uint32_t> buckets(header.bucketCount, 0);
+    uint64_t offset = header.stringsOffset, storedBytes = 0, sourceBytes = 0;
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        if (!packed[i].ok)
+        {
+            cout << "ERROR::ASSET_PACK:: could not read " << files[i] << endl;
+            return false;
+        }
+        packed[i].entry.pathOffset = offset;
+        packed[i].entry.pathLength = (uint32_t)files[i].size();
+        offset += files[i].size();
+        uint32_t bucket = (uint32_t)packed[i].entry.hash & (header.bucketCount - 1);
+        while (buckets[bucket] != 0)
+            bucket = (bucket + 1) & (header.bucketCount - 1);
+        buckets[bucket] = (uint32_t)i + 1;
+    }
+    for (Packed &p : packed)
+    {
+        offset = (offset + ASSET_PACK_ALIGNMENT - 1) & ~(ASSET_PACK_ALIGNMENT - 1);
+        p.entry.dataOffset = offset;
+        offset += p.contents.size();
+        storedBytes += p.entry.storedSize;
+        sourceBytes += p.entry.size;
+    }
+
+    string temporaryPath = packPath + ".tmp" + to_string(getpid());
+    ofstream out(temporaryPath, ios::binary | ios::trunc);
+    if (!out)
+    {
+        cout << "ERROR::ASSET_PACK:: could not write " << temporaryPath << endl;
+        return false;
+    }
+    out.write((const char *)&header, sizeof(header));
+    for (const Packed &p : packed)
+        out.write((const char *)&p.entry, sizeof(p.entry));
+    out.write((const char *)buckets.data(), buckets.size() * sizeof(uint32_t));
+    for (const string &file : files)
+        out.write(file.data(), file.size());
+    static const char padding[ASSET_PACK_ALIGNMENT] = {};
+    for (const Packed &p : packed)
+    {
+        out.write(padding, p.entry.dataOffset - (uint64_t)out.tellp());
+        out.write((const char *)p.contents.data(), p.contents.size());
+    }
+    out.close();
+    if (!out || rename(temporaryPath.c_str(), packPath.c_str()) != 0)
+    {
+        cout << "ERROR::ASSET_PACK:: could not write " << packPath << endl;
+        remove(temporaryPath.c_str());
+        return false;
+    }
+    cout << "ASSET_PACK:: " << packPath << ": " << files.size() << " files, " << sourceBytes / 1024.0 / 1024.0 << " MB stored in "
+         << storedBytes / 1024.0 / 1024.0 << " MB" << endl;
+    return true;
+}
+#endif
@@ -0,0 +1,122 @@
+#ifndef FRAME_UNIFORMS_H
+#define FRAME_UNIFORMS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <learnopengl/camera.h>
+#include <learnopengl/shader.h>
+
+#include <cstdint>
+using namespace std;
+
+// uniform buffer binding point the Frame block of every program is connected to (see light_buffer.h for 0)
+const GLuint FRAME_UNIFORMS_BINDING = 1;
+
+// the Frame block in std140 layout:
+//     layout (std140) uniform Frame {
+//         mat4 projection;
+//         mat4 view;
+//         vec3 viewPosition;
+//         float far_plane;
+//         bool shadows;
+//     };
+struct FrameUniformsStd140 {
+    glm::mat4 projection;
+    glm::mat4 view;
+    glm::vec3 viewPosition;
+    float farPlane;
+    int32_t shadows;
+    int32_t padding[3];
+};
+static_assert(sizeof(FrameUniformsStd140) == 160, "FrameUniformsStd140 must match the std140 layout of the Frame block");
+
+// what the Frame block is computed from besides the camera
+struct FrameSettings {
+    float aspect;
+    float nearPlane;
+    float farPlane;
+    float shadowFarPlane; // range of the point light shadow maps, far_plane in the shaders
+    bool shadows;
+};
+
+// The camera and scene uniforms every program reads, in one uniform buffer bound once at
+// FRAME_UNIFORMS_BINDING. Update() recomputes only what its inputs changed (the projection when the zoom or
+// the clip planes did, the view when the camera moved or turned) and uploads the block only when something did.
+class FrameUniformBuffer
+{
+public:
+    FrameUniformBuffer() : ubo(0), valid(false) {}
+
+    void Create()
+    {
+        glGenBuffers(1, &ubo);
+        glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniformsStd140), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORMS_BINDING, ubo);
+    }
+
+    // deletes the buffer; the context must still be current.
+    void Release()
+    {
+        glDeleteBuffers(1, &ubo);
+        ubo = 0;
+    }
+
+    // connects the Frame block of a program to the buffer; again after the program is rebuilt.
+    static void Bind(const Shader &shader)
+    {
+        GLuint index = glGetUniformBlockIndex(shader.ID, "Frame");
+        if (index != GL_INVALID_INDEX)
+            glUniformBlockBinding(shader.ID, index, FRAME_UNIFORMS_BINDING);
+    }
+
+    // returns whether the block changed and was uploaded.
+    bool Update(Camera &camera, const FrameSettings &settings)
+    {
+        bool projectionChanged = !valid || camera.Zoom != zoom || settings.aspect != this->settings.aspect
+                                 || settings.nearPlane != this->settings.nearPlane || settings.farPlane != this->settings.farPlane;
+        bool viewChanged = !valid || camera.Position != position || camera.Front != front || camera.Up != up;
+        bool sceneChanged = !valid || settings.shadowFarPlane != this->settings.shadowFarPlane || settings.shadows != this->settings.shadows;
+        if (!projectionChanged && !viewChanged && !sceneChanged)
+            return false;
+
+        if (projectionChanged)
+        {
+            block.projection = glm::perspective(glm::radians(camera.Zoom), settings.aspect, settings.nearPlane, settings.farPlane);
+            zoom = camera.Zoom;
+        }
+        if (viewChanged)
+        {
+            block.view = camera.GetViewMatrix();
+            block.viewPosition = camera.Position;
+            position = camera.Position;
+            front = camera.Front;
+            up = camera.Up;
+        }
+        block.farPlane = settings.shadowFarPlane;
+        block.shadows = settings.shadows ? 1 : 0;
+        this->settings = settings;
+        valid = true;
+
+        glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(block), &block);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        return true;
+    }
+
+    const glm::mat4 &Projection() const { return block.projection; }
+    const glm::mat4 &View() const { return block.view; }
+
+private:
+    unsigned int ubo;
+    FrameUniformsStd140 block;
+    // inputs of the uploaded block
+    bool valid;
+    FrameSettings settings;
+    float zoom;
+    glm::vec3 position, front, up;
+};
+#endif
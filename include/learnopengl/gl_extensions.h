@@ -0,0 +1,90 @@
+#ifndef GL_EXTENSIONS_H
+#define GL_EXTENSIONS_H
+
+#include <glad/glad.h>
+
+#include <cstring>
+
+// runtime queries for features beyond the GL 3.3 core profile the glad loader was generated for.
+
+inline bool HasGLExtension(const char *name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++)
+    {
+        const char *extension = (const char *)glGetStringi(GL_EXTENSIONS, i);
+        if (extension && strcmp(extension, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+inline bool HasGLVersion(int major, int minor)
+{
+    GLint contextMajor = 0, contextMinor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &contextMajor);
+    glGetIntegerv(GL_MINOR_VERSION, &contextMinor);
+    return contextMajor > major || (contextMajor == major && contextMinor >= minor);
+}
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+// entry points glad does not load, resolved by LoadGLExtensions; null when the context lacks them.
+struct GLExtensionFunctions {
+    // GL 4.1 / ARB_get_program_binary
+    void (APIENTRYP GetProgramBinary)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary) = nullptr;
+    void (APIENTRYP ProgramBinary)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length) = nullptr;
+    void (APIENTRYP ProgramParameteri)(GLuint program, GLenum pname, GLint value) = nullptr;
+    // KHR_parallel_shader_compile (or its ARB twin, which shares the completion status query)
+    void (APIENTRYP MaxShaderCompilerThreads)(GLuint count) = nullptr;
+};
+
+inline GLExtensionFunctions &GLExtensions()
+{
+    static GLExtensionFunctions functions;
+    return functions;
+}
+
+// whether GL_COMPLETION_STATUS_KHR can be queried, so shader builds can be polled without blocking.
+inline bool ParallelShaderCompileSupported()
+{
+    return GLExtensions().MaxShaderCompilerThreads != nullptr;
+}
+
+// lets the driver compile on as many threads as it likes; the setting is per context, so every context that
+// builds shaders calls this once it is current.
+inline void EnableParallelShaderCompile()
+{
+    if (ParallelShaderCompileSupported())
+        GLExtensions().MaxShaderCompilerThreads(0xFFFFFFFFu);
+}
+
+// resolves the GLExtensionFunctions with the loader glad was initialized with; call once the context is current.
+inline void LoadGLExtensions(GLADloadproc load)
+{
+    GLExtensionFunctions &functions = GLExtensions();
+    if (HasGLVersion(4, 1) || HasGLExtension("GL_ARB_get_program_binary"))
+    {
+        functions.GetProgramBinary = (decltype(functions.GetProgramBinary))load("glGetProgramBinary");
+        functions.ProgramBinary = (decltype(functions.ProgramBinary))load("glProgramBinary");
+        functions.ProgramParameteri = (decltype(functions.ProgramParameteri))load("glProgramParameteri");
+    }
+    if (HasGLExtension("GL_KHR_parallel_shader_compile"))
+        functions.MaxShaderCompilerThreads = (decltype(functions.MaxShaderCompilerThreads))load("glMaxShaderCompilerThreadsKHR");
+    else if (HasGLExtension("GL_ARB_parallel_shader_compile"))
+        functions.MaxShaderCompilerThreads = (decltype(functions.MaxShaderCompilerThreads))load("glMaxShaderCompilerThreadsARB");
+    EnableParallelShaderCompile();
+}
+#endif
@@ -0,0 +1,475 @@
+#ifndef HOT_RELOAD_H
+#define HOT_RELOAD_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <learnopengl/model.h>
+#include <learnopengl/shader.h>
+#include <learnopengl/texture_registry.h>
+#include <learnopengl/thread_pool.h>
+
+#include <sys/inotify.h>
+#include <dirent.h>
+#include <unistd.h>
+
+#include <cctype>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+// a changed file is only acted on once it has been quiet this long, editors and exporters often write in several steps
+const int HOT_RELOAD_SETTLE_MILLISECONDS = 100;
+
+// Non-blocking inotify watch over directory trees, reporting files that were written or moved into place.
+class FileWatcher
+{
+public:
+    FileWatcher() : fd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+    {
+        if (fd < 0)
+            cout << "ERROR::HOT_RELOAD:: inotify is not available, files are not watched" << endl;
+    }
+
+    ~FileWatcher()
+    {
+        if (fd >= 0)
+            close(fd);
+    }
+
+    FileWatcher(const FileWatcher &) = delete;
+    FileWatcher &operator=(const FileWatcher &) = delete;
+
+    // watches a directory and every directory below it, including ones created later. Files already in the tree
+    // are appended to existing when given.
+    void WatchTree(const string &directory, vector<string> *existing = nullptr)
+    {
+        if (fd < 0)
+            return;
+        int wd = inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_ONLYDIR);
+        if (wd < 0)
+            return;
+        directories[wd] = directory;
+        DIR *dir = opendir(directory.c_str());
+        if (!dir)
+            return;
+        while (dirent *entry = readdir(dir))
+        {
+            string name = entry->d_name;
+            if (name == "." || name == "..")
+                continue;
+            if (entry->d_type == DT_DIR)
+                WatchTree(directory + '/' + name, existing);
+            else if (existing)
+                existing->push_back(directory + '/' + name);
+        }
+        closedir(dir);
+    }
+
+    // appends the files changed since the last call; never blocks.
+    void Poll(vector<string> &changed)
+    {
+        if (fd < 0)
+            return;
+        alignas(inotify_event) char buffer[16 * 1024];
+        for (;;)
+        {
+            ssize_t length = read(fd, buffer, sizeof(buffer));
+            if (length <= 0)
+                return; // EAGAIN, nothing more queued
+            for (char *p = buffer; p < buffer + length;)
+            {
+                const inotify_event *event = (const inotify_event *)p;
+                p += sizeof(inotify_event) + event->len;
+                auto directory = directories.find(event->wd);
+                if (directory == directories.end())
+                    continue;
+                if (event->mask & IN_IGNORED)
+                {
+                    directories.erase(directory);
+                    continue;
+                }
+                if (event->len == 0)
+                    continue;
+                string path = directory->second + '/' + event->name;
+                if (event->mask & IN_ISDIR)
+                {
+                    // files written before the watch was in place produce no events of their own
+                    if (event->mask & (IN_CREATE | IN_MOVED_TO))
+                        WatchTree(path, &changed);
+                }
+                else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+                    changed.push_back(path);
+            }
+        }
+    }
+
+private:
+    int fd;
+    unordered_map<int, string> directories;
+};
+
+// Rebuilds shaders and re-imports models (and their textures) when their files under resources/shaders or
+// resources/objects change, without stalling the render loop:
+//  - programs are compiled and linked on a thread of its own, with a hidden context sharing objects with the main one;
+//    all pending rebuilds are submitted together so the driver compiles them concurrently (see ShaderBatch)
+//  - models are imported on the loader pool; only their buffers and VAOs are created on the context thread,
+//    since VAOs can not be shared between contexts
+//  - textures are decoded again into their existing names by the TextureLoader
+// Update() is called once per frame, between frames, and swaps in whatever has finished. Until then the old
+// programs and meshes keep being drawn, and a build or import that fails leaves them in place.
+class HotReloader
+{
+public:
+    // window is the main window, its context must be current on the calling thread.
+    explicit HotReloader(GLFWwindow *window) : compileWindow(nullptr), stopping(false)
+    {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        compileWindow = glfwCreateWindow(1, 1, "shader compiler", NULL, window);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+        if (compileWindow)
+            compiler = thread([this] { compileLoop(); });
+        else
+            cout << "ERROR::HOT_RELOAD:: no shared context, shaders are rebuilt on the main thread" << endl;
+        watcher.WatchTree("resources/shaders");
+        watcher.WatchTree("resources/objects");
+    }
+
+    ~HotReloader()
+    {
+        if (compileWindow)
+        {
+            {
+                lock_guard<mutex> lock(compileMutex);
+                stopping = true;
+            }
+            compileWakeup.notify_all();
+            compiler.join();
+            glfwDestroyWindow(compileWindow);
+        }
+        for (BuildingProgram &building : this->building)
+            compiled.push_back(finishBuild(building));
+        compiled.insert(compiled.end(), finished.begin(), finished.end());
+        for (CompiledProgram &program : compiled)
+        {
+            glDeleteSync(program.fence);
+            glDeleteProgram(program.program);
+        }
+    }
+
+    HotReloader(const HotReloader &) = delete;
+    HotReloader &operator=(const HotReloader &) = delete;
+
+    // rebuilds the program of shader whenever one of its source files changes. onReload runs right after the new
+    // program is swapped in, for uniforms that are set once instead of every frame.
+    void Watch(Shader &shader, function<void(Shader &)> onReload = nullptr)
+    {
+        WatchedShader watched;
+        watched.shader = &shader;
+        watched.onReload = onReload;
+        watched.files.push_back(canonicalPath(shader.vertexPath));
+        watched.files.push_back(canonicalPath(shader.fragmentPath));
+        if (!shader.geometryPath.empty())
+            watched.files.push_back(canonicalPath(shader.geometryPath));
+        shaders.push_back(watched);
+    }
+
+    // re-imports model whenever a file in its directory changes; changed images only reload the textures.
+    void Watch(Model &model)
+    {
+        WatchedModel watched;
+        watched.model = &model;
+        watched.directory = canonicalPath(model.directory) + '/';
+        watched.again = false;
+        models.push_back(std::move(watched));
+    }
+
+    // picks up file changes and swaps in finished rebuilds; call once per frame on the context thread.
+    void Update()
+    {
+        typedef chrono::steady_clock clock;
+        vector<string> changed;
+        watcher.Poll(changed);
+        clock::time_point now = clock::now();
+        for (const string &path : changed)
+            settling[path] = now;
+        for (auto it = settling.begin(); it != settling.end();)
+        {
+            if (now - it->second < chrono::milliseconds(HOT_RELOAD_SETTLE_MILLISECONDS))
+            {
+                ++it;
+                continue;
+            }
+            fileChanged(it->first);
+            it = settling.erase(it);
+        }
+        swapPrograms();
+        swapModels();
+    }
+
+private:
+    struct WatchedShader {
+        Shader *shader;
+        function<void(Shader &)> onReload;
+        vector<string> files; // canonical
+    };
+
+    struct WatchedModel {
+        Model *model;
+        string directory; // canonical, with a trailing slash
+        future<ModelData> import;
+        chrono::steady_clock::time_point start;
+        bool again; // changed again while the import was running
+    };
+
+    struct CompileJob {
+        size_t shader;
+        string vertexPath, fragmentPath, geometryPath;
+        chrono::steady_clock::time_point start;
+    };
+
+    struct BuildingProgram {
+        CompileJob job;
+        ShaderBuild build;
+        bool sourcesRead;
+    };
+
+    struct CompiledProgram {
+        size_t shader;
+        unsigned int program; // 0 when the build failed
+        GLsync fence;         // signalled once the program is usable from the main context
+        chrono::steady_clock::time_point start;
+    };
+
+    FileWatcher watcher;
+    unordered_map<string, chrono::steady_clock::time_point> settling; // changed files, by time of the last change
+    vector<WatchedShader> shaders;
+    vector<WatchedModel> models;
+
+    GLFWwindow *compileWindow;
+    thread compiler;
+    mutex compileMutex;
+    condition_variable compileWakeup;
+    bool stopping;
+    deque<CompileJob> jobs;            // guarded by compileMutex
+    deque<CompiledProgram> finished;   // guarded by compileMutex
+    deque<CompiledProgram> compiled;   // main thread only: builds waiting for their fence
+    deque<BuildingProgram> building;   // main thread only, without a shared context: builds the driver is still on
+
+    static string canonicalPath(const string &path)
+    {
+        char resolved[PATH_MAX];
+        if (realpath(path.c_str(), resolved))
+            return string(resolved);
+        return path;
+    }
+
+    static bool isImage(const string &path)
+    {
+        size_t dot = path.find_last_of('.');
+        if (dot == string::npos)
+            return false;
+        string extension = path.substr(dot + 1);
+        for (char &c : extension)
+            c = (char)tolower(c);
+        return extension == "png" || extension == "jpg" || extension == "jpeg" || extension == "tga" || extension == "bmp";
+    }
+
+    void fileChanged(const string &changedPath)
+    {
+        string path = canonicalPath(changedPath);
+        for (size_t i = 0; i < shaders.size(); i++)
+            for (const string &file : shaders[i].files)
+                if (file == path)
+                {
+                    cout << "HOT_RELOAD:: " << changedPath << " changed, rebuilding shader" << endl;
+                    rebuild(i);
+                    break;
+                }
+        if (isImage(path))
+        {
+            // the registry keys textures by VFS path, which a resolved symlink need not match
+            unsigned int reloaded = TextureRegistry::Instance().Reload(changedPath);
+            if (reloaded > 0)
+                cout << "HOT_RELOAD:: " << changedPath << " changed, reloading " << reloaded << " texture(s)" << endl;
+            return;
+        }
+        for (WatchedModel &watched : models)
+            if (path.compare(0, watched.directory.size(), watched.directory) == 0)
+            {
+                cout << "HOT_RELOAD:: " << changedPath << " changed, re-importing " << watched.model->path << endl;
+                reimport(watched);
+            }
+    }
+
+    void rebuild(size_t shader)
+    {
+        CompileJob job;
+        job.shader = shader;
+        job.vertexPath = shaders[shader].shader->vertexPath;
+        job.fragmentPath = shaders[shader].shader->fragmentPath;
+        job.geometryPath = shaders[shader].shader->geometryPath;
+        job.start = chrono::steady_clock::now();
+        if (!compileWindow)
+        {
+            // without a second context the build is submitted here and checked between frames once it is done
+            building.push_back(startBuild(job));
+            return;
+        }
+        {
+            lock_guard<mutex> lock(compileMutex);
+            jobs.push_back(job);
+        }
+        compileWakeup.notify_one();
+    }
+
+    // these run on the compile thread, or on the main thread without a shared context.
+    static BuildingProgram startBuild(const CompileJob &job)
+    {
+        BuildingProgram building;
+        building.job = job;
+        string vertexCode, fragmentCode, geometryCode;
+        building.sourcesRead = Shader::ReadSources(job.vertexPath, job.fragmentPath, job.geometryPath, vertexCode, fragmentCode, geometryCode);
+        if (building.sourcesRead)
+            building.build = Shader::BeginBuild(vertexCode, fragmentCode, geometryCode);
+        else
+            cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << endl;
+        return building;
+    }
+
+    static CompiledProgram finishBuild(BuildingProgram &building)
+    {
+        CompiledProgram result;
+        result.shader = building.job.shader;
+        result.program = 0;
+        result.start = building.job.start;
+        if (building.sourcesRead)
+        {
+            bool success;
+            result.program = Shader::FinishBuild(building.build, &success);
+        }
+        result.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+        return result;
+    }
+
+    void compileLoop()
+    {
+        Tracer::Instance().NameThread("shader compiler");
+        glfwMakeContextCurrent(compileWindow);
+        EnableParallelShaderCompile();
+        for (;;)
+        {
+            deque<CompileJob> batch;
+            {
+                unique_lock<mutex> lock(compileMutex);
+                compileWakeup.wait(lock, [this] { return stopping || !jobs.empty(); });
+                if (stopping)
+                    break;
+                batch.swap(jobs);
+            }
+            // submit everything first, then hand the programs over in order as the driver finishes them, so a
+            // newer build of a shader always lands after an older one
+            deque<BuildingProgram> builds;
+            for (const CompileJob &job : batch)
+                builds.push_back(startBuild(job));
+            while (!builds.empty())
+            {
+                if (builds.front().sourcesRead && !Shader::BuildReady(builds.front().build))
+                {
+                    this_thread::sleep_for(chrono::milliseconds(1));
+                    continue;
+                }
+                CompiledProgram result = finishBuild(builds.front());
+                builds.pop_front();
+                lock_guard<mutex> lock(compileMutex);
+                finished.push_back(result);
+            }
+        }
+        glfwMakeContextCurrent(NULL);
+    }
+
+    // swaps in programs whose build has completed, in the order they were requested.
+    void swapPrograms()
+    {
+        while (!building.empty() && (!building.front().sourcesRead || Shader::BuildReady(building.front().build)))
+        {
+            compiled.push_back(finishBuild(building.front()));
+            building.pop_front();
+        }
+        {
+            lock_guard<mutex> lock(compileMutex);
+            compiled.insert(compiled.end(), finished.begin(), finished.end());
+            finished.clear();
+        }
+        while (!compiled.empty())
+        {
+            CompiledProgram &next = compiled.front();
+            GLint status = GL_UNSIGNALED;
+            glGetSynciv(next.fence, GL_SYNC_STATUS, 1, NULL, &status);
+            if (status != GL_SIGNALED)
+                return;
+            glDeleteSync(next.fence);
+            WatchedShader &watched = shaders[next.shader];
+            float ms = chrono::duration<float, milli>(chrono::steady_clock::now() - next.start).count();
+            if (next.program)
+            {
+                // copies of the Shader made before this point still name the old program, which GL keeps
+                // alive until it is no longer current
+                ProgramUniforms::Forget(watched.shader->ID);
+                glDeleteProgram(watched.shader->ID);
+                watched.shader->ID = next.program;
+                if (watched.onReload)
+                    watched.onReload(*watched.shader);
+                cout << "HOT_RELOAD:: " << watched.shader->fragmentPath << " program swapped in after " << ms << " ms" << endl;
+            }
+            else
+                cout << "HOT_RELOAD:: " << watched.shader->fragmentPath << " failed to build, keeping the previous program" << endl;
+            compiled.pop_front();
+        }
+    }
+
+    void reimport(WatchedModel &watched)
+    {
+        if (watched.import.valid())
+        {
+            watched.again = true;
+            return;
+        }
+        string path = watched.model->path;
+        const ImportProfile &profile = FindImportProfile(watched.model->importProfile);
+        watched.start = chrono::steady_clock::now();
+        watched.import = ThreadPool::Loaders().Submit([path, &profile] { return Model::Import(path, profile, MeshCacheMode::Refresh); });
+    }
+
+    void swapModels()
+    {
+        for (WatchedModel &watched : models)
+        {
+            if (!watched.import.valid() || watched.import.wait_for(chrono::seconds(0)) != future_status::ready)
+                continue;
+            if (watched.model->Replace(watched.import.get()))
+                cout << "HOT_RELOAD:: " << watched.model->path << " swapped in after "
+                     << chrono::duration<float, milli>(chrono::steady_clock::now() - watched.start).count() << " ms" << endl;
+            else
+                cout << "HOT_RELOAD:: " << watched.model->path << " failed to import, keeping the previous version" << endl;
+            if (watched.again)
+            {
+                watched.again = false;
+                reimport(watched);
+            }
+        }
+    }
+};
+#endif
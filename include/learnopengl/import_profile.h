@@ -0,0 +1,88 @@
+#ifndef IMPORT_PROFILE_H
+#define IMPORT_PROFILE_H
+
+#include <assimp/postprocess.h>
+
+#include <learnopengl/mesh_cache.h>
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+using namespace std;
+
+// post-processing every model needs to be drawn by our shaders
+const unsigned int MODEL_IMPORT_FLAGS = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace;
+
+// A named set of processing steps applied when a model is imported (see Model::Import). Every profile has its
+// own mesh cache entry, so switching profiles never reads meshes processed by another one.
+struct ImportProfile {
+    const char *name;
+    unsigned int assimpFlags; // post-processing when the model goes through Assimp
+    bool nativeObj;           // read OBJ files with obj_loader.h instead of Assimp
+    bool weld;                // merge identical vertices
+    bool flatten;             // merge the meshes that share a material, so each material is one draw call
+    bool optimize;            // vertex cache, overdraw and vertex fetch order (see mesh_optimizer.h)
+    bool buildLods;           // simplified levels of detail (see mesh_simplifier.h)
+
+    // the mesh cache variant of the profile: its name and processing steps, so that a profile whose steps are
+    // changed does not read meshes it cached before
+    string CacheVariant() const
+    {
+        unsigned int steps = nativeObj | weld << 1 | flatten << 2 | optimize << 3 | buildLods << 4;
+        return string(name) + '#' + to_string(steps);
+    }
+};
+
+// fast-load:       least work at import, meshes are drawn as the file lays them out
+// runtime-optimal: fewest draw calls and vertices, ordered for the post-transform cache, with LODs
+// debug:           always through Assimp with its validation steps and without anything that merges or
+//                  reorders, so meshes stay recognisable
+const ImportProfile IMPORT_PROFILES[] = {
+    {"fast-load", MODEL_IMPORT_FLAGS, true, false, false, false, false},
+    {"runtime-optimal", MODEL_IMPORT_FLAGS | aiProcess_JoinIdenticalVertices | aiProcess_ImproveCacheLocality | aiProcess_RemoveRedundantMaterials
+                        | aiProcess_OptimizeMeshes | aiProcess_OptimizeGraph, true, true, true, true, true},
+    {"debug", MODEL_IMPORT_FLAGS | aiProcess_ValidateDataStructure | aiProcess_FindInvalidData | aiProcess_FindDegenerates, false, false, false,
+              false, false},
+};
+
+const char DEFAULT_IMPORT_PROFILE[] = "runtime-optimal";
+
+// the profile with the given name; unknown names report an error and use the default profile.
+inline const ImportProfile &FindImportProfile(const string &name)
+{
+    for (const ImportProfile &profile : IMPORT_PROFILES)
+        if (name == profile.name)
+            return profile;
+    cout << "ERROR::IMPORT_PROFILE:: unknown profile " << name << ", using " << DEFAULT_IMPORT_PROFILE << endl;
+    return FindImportProfile(DEFAULT_IMPORT_PROFILE);
+}
+
+// merges meshes with identical texture lists and material parameters into the first of them, keeping the order
+// of first appearance.
+inline void MergeMeshesByMaterial(vector<MeshData> &meshes)
+{
+    vector<MeshData> merged;
+    map<pair<vector<pair<string, string>>, pair<float, float>>, size_t> byMaterial;
+    for (MeshData &mesh : meshes)
+    {
+        pair<vector<pair<string, string>>, pair<float, float>> material;
+        for (const Texture &texture : mesh.textures)
+            material.first.push_back(make_pair(texture.type, texture.path));
+        material.second = make_pair(mesh.material.shininess, mesh.material.opacity);
+        auto it = byMaterial.find(material);
+        if (it == byMaterial.end())
+        {
+            byMaterial[material] = merged.size();
+            merged.push_back(std::move(mesh));
+            continue;
+        }
+        MeshData &target = merged[it->second];
+        unsigned int base = (unsigned int)target.vertices.size();
+        target.vertices.insert(target.vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+        for (unsigned int index : mesh.indices)
+            target.indices.push_back(base + index);
+    }
+    meshes.swap(merged);
+}
+#endif
@@ -0,0 +1,183 @@
+#ifndef LIGHT_BUFFER_H
+#define LIGHT_BUFFER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+using namespace std;
+
+struct PointLight {
+    glm::vec3 position;
+    glm::vec3 ambient;
+    glm::vec3 diffuse;
+    glm::vec3 specular;
+
+    float constant;
+    float linear;
+    float quadratic;
+};
+
+// size of the pointLights array of the PointLights block in the shaders
+const unsigned int MAX_POINT_LIGHTS = 10;
+// uniform buffer binding point the PointLights block of every program is connected to
+const GLuint POINT_LIGHTS_BINDING = 0;
+
+// one element of pointLights[] in std140 layout: vec3s take 16 bytes, except that the float following the last
+// one fills its fourth component, and the struct is padded to a multiple of 16. Members in shader order.
+struct PointLightStd140 {
+    glm::vec3 position;
+    float padding0;
+    glm::vec3 specular;
+    float padding1;
+    glm::vec3 diffuse;
+    float padding2;
+    glm::vec3 ambient;
+    float constant;
+    float linear;
+    float quadratic;
+    float padding3[2];
+};
+static_assert(sizeof(PointLightStd140) == 80, "PointLightStd140 must match the std140 layout of PointLight");
+
+// the PointLights block:
+//     layout (std140) uniform PointLights {
+//         PointLight pointLights[MAX_POINT_LIGHTS];
+//         int num_of_lights;
+//     };
+struct PointLightsStd140 {
+    PointLightStd140 lights[MAX_POINT_LIGHTS];
+    int32_t count;
+    int32_t padding[3];
+};
+
+// Keeps the point lights in a uniform buffer shared by every program that declares the PointLights block. The
+// buffer is the owner of the lights: changes go through Set/Edit, which mark the light dirty, and Upload()
+// sends only the dirty lights, so frames in which no light changed make no GL calls for them.
+class PointLightBuffer
+{
+public:
+    PointLightBuffer() : ubo(0), countDirty(true) {}
+
+    void Create()
+    {
+        glGenBuffers(1, &ubo);
+        glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(PointLightsStd140), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, POINT_LIGHTS_BINDING, ubo);
+    }
+
+    // deletes the buffer; the context must still be current.
+    void Release()
+    {
+        glDeleteBuffers(1, &ubo);
+        ubo = 0;
+    }
+
+    // connects the PointLights block of a program to the buffer. Block bindings are program state, so a
+    // rebuilt program has to be bound again.
+    static void Bind(const Shader &shader)
+    {
+        GLuint index = glGetUniformBlockIndex(shader.ID, "PointLights");
+        if (index != GL_INVALID_INDEX)
+            glUniformBlockBinding(shader.ID, index, POINT_LIGHTS_BINDING);
+    }
+
+    // returns the index of the light, or -1 when the block is full.
+    int Add(const PointLight &light)
+    {
+        if (lights.size() >= MAX_POINT_LIGHTS)
+        {
+            cout << "ERROR::LIGHTS:: at most " << MAX_POINT_LIGHTS << " point lights" << endl;
+            return -1;
+        }
+        lights.push_back(light);
+        dirty.push_back(true);
+        countDirty = true;
+        return (int)lights.size() - 1;
+    }
+
+    const PointLight &Get(unsigned int index) const { return lights[index]; }
+
+    void Set(unsigned int index, const PointLight &light)
+    {
+        lights[index] = light;
+        dirty[index] = true;
+    }
+
+    // for changing a light in place; marks it dirty whether or not it is changed.
+    PointLight &Edit(unsigned int index)
+    {
+        dirty[index] = true;
+        return lights[index];
+    }
+
+    unsigned int Size() const { return (unsigned int)lights.size(); }
+
+    // uploads the lights changed since the last call, adjacent ones in a single glBufferSubData. Returns how
+    // many lights were uploaded.
+    unsigned int Upload()
+    {
+        unsigned int uploaded = 0;
+        bool bound = false;
+        for (size_t first = 0; first < lights.size();)
+        {
+            if (!dirty[first])
+            {
+                first++;
+                continue;
+            }
+            size_t end = first;
+            PointLightStd140 staged[MAX_POINT_LIGHTS];
+            for (; end < lights.size() && dirty[end]; end++)
+            {
+                staged[end - first] = std140(lights[end]);
+                dirty[end] = false;
+            }
+            if (!bound)
+                glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+            bound = true;
+            glBufferSubData(GL_UNIFORM_BUFFER, first * sizeof(PointLightStd140), (end - first) * sizeof(PointLightStd140), staged);
+            uploaded += (unsigned int)(end - first);
+            first = end;
+        }
+        if (countDirty)
+        {
+            int32_t count = (int32_t)lights.size();
+            if (!bound)
+                glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+            bound = true;
+            glBufferSubData(GL_UNIFORM_BUFFER, offsetof(PointLightsStd140, count), sizeof(count), &count);
+            countDirty = false;
+        }
+        if (bound)
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        return uploaded;
+    }
+
+private:
+    unsigned int ubo;
+    vector<PointLight> lights;
+    vector<bool> dirty;
+    bool countDirty;
+
+    static PointLightStd140 std140(const PointLight &light)
+    {
+        PointLightStd140 packed = {};
+        packed.position = light.position;
+        packed.specular = light.specular;
+        packed.diffuse = light.diffuse;
+        packed.ambient = light.ambient;
+        packed.constant = light.constant;
+        packed.linear = light.linear;
+        packed.quadratic = light.quadratic;
+        return packed;
+    }
+};
+#endif
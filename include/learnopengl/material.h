@@ -0,0 +1,263 @@
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/shader.h>
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+using namespace std;
+
+struct Texture {
+    unsigned int id;
+    string type;
+    string path;
+};
+
+// What a texture of a mesh is used for. Texture::type holds the same as a string ("texture_diffuse", ...),
+// which is what importers produce and the mesh cache stores; it is resolved to a role once, when the mesh's
+// Material is built.
+enum class TextureRole {
+    Diffuse,
+    Specular,
+    Normal,
+    Height
+};
+const unsigned int TEXTURE_ROLE_COUNT = 4;
+// samplers per role the shaders may declare (texture_diffuse1, texture_diffuse2); further textures are not bound
+const unsigned int MAX_TEXTURES_PER_ROLE = 2;
+// uniform buffer binding point of the Material block (see light_buffer.h and frame_uniforms.h for 0 and 1)
+const GLuint MATERIAL_BINDING = 2;
+
+inline const char *TextureRoleType(TextureRole role)
+{
+    static const char *types[TEXTURE_ROLE_COUNT] = {"texture_diffuse", "texture_specular", "texture_normal", "texture_height"};
+    return types[(unsigned int)role];
+}
+
+inline bool TextureRoleFromType(const string &type, TextureRole &role)
+{
+    for (unsigned int i = 0; i < TEXTURE_ROLE_COUNT; i++)
+        if (type == TextureRoleType((TextureRole)i))
+        {
+            role = (TextureRole)i;
+            return true;
+        }
+    return false;
+}
+
+// Every sampler has a fixed texture unit: the Nth texture of a role (1-based, as in texture_diffuseN) is bound
+// to unit role * MAX_TEXTURES_PER_ROLE + N - 1, so units 0-7. The sampler uniforms of a program are therefore
+// set once after it is built (see BindMaterialSamplers) and never while drawing.
+inline unsigned int MaterialTextureUnit(TextureRole role, unsigned int index)
+{
+    return (unsigned int)role * MAX_TEXTURES_PER_ROLE + index;
+}
+
+// points the material samplers of a program (prefix + "texture_diffuse1", ...) at their texture units. Sampler
+// bindings are program state, so a rebuilt program has to be bound again.
+inline void BindMaterialSamplers(const Shader &shader, const string &prefix)
+{
+    GLint current = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+    glUseProgram(shader.ID);
+    for (unsigned int role = 0; role < TEXTURE_ROLE_COUNT; role++)
+        for (unsigned int index = 0; index < MAX_TEXTURES_PER_ROLE; index++)
+        {
+            GLint location = shader.location(prefix + TextureRoleType((TextureRole)role) + to_string(index + 1));
+            if (location >= 0)
+                glUniform1i(location, (GLint)MaterialTextureUnit((TextureRole)role, index));
+        }
+    GLuint block = glGetUniformBlockIndex(shader.ID, "MaterialBlock");
+    if (block != GL_INVALID_INDEX)
+        glUniformBlockBinding(shader.ID, block, MATERIAL_BINDING);
+    glUseProgram((GLuint)current);
+}
+
+// the parameters of the MaterialBlock:
+//     layout (std140) uniform MaterialBlock {
+//         float shininess;
+//         float opacity;
+//     };
+struct MaterialParameters {
+    float shininess = 32.0f; // Blinn-Phong specular exponent
+    float opacity = 1.0f;    // below 1 the material is drawn blended, after the opaque geometry
+};
+
+struct MaterialParametersStd140 {
+    float shininess;
+    float opacity;
+    float padding[2];
+};
+
+const unsigned int MATERIAL_TEXTURE_UNITS = TEXTURE_ROLE_COUNT * MAX_TEXTURES_PER_ROLE;
+
+// what Material::Bind last bound to the material texture units and the MaterialBlock binding, so that binds
+// which would change nothing are skipped. Reset whenever something else may have bound to them.
+struct MaterialBindings {
+    unsigned int textures[MATERIAL_TEXTURE_UNITS];
+    unsigned int block;
+
+    MaterialBindings() { Reset(); }
+
+    void Reset()
+    {
+        for (unsigned int &texture : textures)
+            texture = ~0u;
+        block = ~0u;
+    }
+};
+
+// Uniform buffers holding MaterialParameters. Materials with equal parameters share a buffer, reference
+// counted like the textures of the TextureRegistry.
+class MaterialBlocks
+{
+public:
+    static MaterialBlocks &Instance()
+    {
+        static MaterialBlocks blocks;
+        return blocks;
+    }
+
+    unsigned int Acquire(const MaterialParameters &parameters)
+    {
+        MaterialParametersStd140 packed = {};
+        packed.shininess = parameters.shininess;
+        packed.opacity = parameters.opacity;
+        string key((const char *)&packed, sizeof(packed));
+        auto it = entries.find(key);
+        if (it != entries.end())
+        {
+            it->second.references++;
+            return it->second.buffer;
+        }
+        Entry entry;
+        glGenBuffers(1, &entry.buffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, entry.buffer);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(packed), &packed, GL_STATIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        entry.references = 1;
+        entries.emplace(key, entry);
+        return entry.buffer;
+    }
+
+    void Release(unsigned int buffer)
+    {
+        for (auto it = entries.begin(); it != entries.end(); ++it)
+            if (it->second.buffer == buffer)
+            {
+                if (--it->second.references == 0)
+                {
+                    glDeleteBuffers(1, &buffer);
+                    entries.erase(it);
+                }
+                return;
+            }
+    }
+
+private:
+    struct Entry {
+        unsigned int buffer;
+        unsigned int references;
+    };
+    map<string, Entry> entries; // by packed parameters
+
+    MaterialBlocks() {}
+};
+
+// The textures and parameters of a mesh, resolved once when the mesh is created: each texture goes to the unit
+// of its role (see MaterialTextureUnit) and the parameters to a shared uniform buffer. Binding it is a
+// glBindTexture per unit and one glBindBufferBase. Copies share the GL objects; Release() is left to the owner,
+// like Mesh::Release.
+class Material
+{
+public:
+    Material() : bindingCount(0), block(0), sortKey(0), transparent(false) {}
+
+    Material(const vector<Texture> &textures, const MaterialParameters &parameters = MaterialParameters())
+        : bindingCount(0), transparent(parameters.opacity < 1.0f)
+    {
+        unsigned int counts[TEXTURE_ROLE_COUNT] = {0, 0, 0, 0};
+        for (const Texture &texture : textures)
+        {
+            TextureRole role;
+            if (!TextureRoleFromType(texture.type, role))
+            {
+                cout << "MATERIAL:: ignoring texture " << texture.path << " of unknown type " << texture.type << endl;
+                continue;
+            }
+            unsigned int &count = counts[(unsigned int)role];
+            if (count < MAX_TEXTURES_PER_ROLE)
+                bindings[bindingCount++] = {MaterialTextureUnit(role, count), texture.id};
+            count++;
+        }
+        // unbind the first unit of roles the mesh has no texture for, so it does not sample the previous mesh's
+        for (unsigned int role = 0; role < TEXTURE_ROLE_COUNT; role++)
+            if (counts[role] == 0)
+                bindings[bindingCount++] = {MaterialTextureUnit((TextureRole)role, 0), 0};
+        block = MaterialBlocks::Instance().Acquire(parameters);
+        // materials binding the same textures and block get the same key, so sorting by it groups them
+        uint32_t hash = 2166136261u;
+        for (unsigned int i = 0; i < bindingCount; i++)
+            hash = (hash ^ (bindings[i].unit << 24 | bindings[i].texture)) * 16777619u;
+        hash = (hash ^ block) * 16777619u;
+        sortKey = (uint16_t)(hash ^ hash >> 16);
+    }
+
+    void Bind() const
+    {
+        for (unsigned int i = 0; i < bindingCount; i++)
+        {
+            glActiveTexture(GL_TEXTURE0 + bindings[i].unit);
+            glBindTexture(GL_TEXTURE_2D, bindings[i].texture);
+        }
+        glBindBufferBase(GL_UNIFORM_BUFFER, MATERIAL_BINDING, block);
+    }
+
+    // binds only what differs from the bindings last made, and records the new ones.
+    void Bind(MaterialBindings &bound) const
+    {
+        for (unsigned int i = 0; i < bindingCount; i++)
+        {
+            const Binding &binding = bindings[i];
+            if (bound.textures[binding.unit] == binding.texture)
+                continue;
+            glActiveTexture(GL_TEXTURE0 + binding.unit);
+            glBindTexture(GL_TEXTURE_2D, binding.texture);
+            bound.textures[binding.unit] = binding.texture;
+        }
+        if (bound.block != block)
+        {
+            glBindBufferBase(GL_UNIFORM_BUFFER, MATERIAL_BINDING, block);
+            bound.block = block;
+        }
+    }
+
+    // 16 bits equal for materials with equal bindings, for sorting draws by material (see render_queue.h)
+    uint16_t SortKey() const { return sortKey; }
+    bool Transparent() const { return transparent; }
+
+    void Release()
+    {
+        if (block)
+            MaterialBlocks::Instance().Release(block);
+        block = 0;
+    }
+
+private:
+    struct Binding {
+        unsigned int unit;
+        unsigned int texture;
+    };
+    Binding bindings[MATERIAL_TEXTURE_UNITS];
+    unsigned int bindingCount;
+    unsigned int block;
+    uint16_t sortKey;
+    bool transparent;
+};
+#endif
@@ -6,100 +6,270 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <learnopengl/material.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/vertex_format.h> // Vertex and its GPU layouts
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <string>
 #include <vector>
 using namespace std;
 
-struct Vertex {
-    // position
-    glm::vec3 Position;
-    // normal
-    glm::vec3 Normal;
-    // texCoords
-    glm::vec2 TexCoords;
-    // tangent
-    glm::vec3 Tangent;
-    // bitangent
-    glm::vec3 Bitangent;
+// one level of detail: a range of the mesh's index buffer drawn over the shared vertex buffer.
+struct MeshLod {
+    unsigned int indexOffset;
+    unsigned int indexCount;
+    float error; // largest geometric deviation from the full mesh, in model units
 };
 
+// camera parameters used to pick mesh LODs by their projected size on screen.
+struct LodSelection {
+    glm::vec3 viewPosition;
+    float pixelsPerUnit;        // viewport height / (2 tan(fovy / 2)): pixels covered by one unit at distance one
+    float maxPixelError = 1.0f; // largest simplification error allowed on screen
+    unsigned int bias = 0;      // levels added on top of the selected one, e.g. for shadow maps
+};
 
-
-struct Texture {
-    unsigned int id;
-    string type;
-    string path;
+// whether a Mesh keeps a CPU copy of its geometry after uploading it. Drawing only needs the GPU buffers, so
+// copies are released unless a consumer that reads vertices back (picking, culling) asks for them.
+enum class GeometryRetention {
+    Release,
+    Keep
 };
 
 class Mesh {
 public:
     // mesh Data
-    vector<Vertex>       vertices;
+    vector<Vertex>       vertices; // empty unless the geometry was kept, see GeometryRetention
     vector<unsigned int> indices;
     vector<Texture>      textures;
+    Material             material; // textures resolved to their units, see material.h
 
     unsigned int VAO;
-    std::string glslIdentifierPrefix;
-    // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+    unsigned int depthVAO; // position-only stream over the same index buffer, for depth passes
+    unsigned int indexCount;
+    vector<MeshLod> lods;   // lods[0] is the full mesh, coarser levels follow it in the same index buffer
+    glm::vec3 boundsCenter; // object space bounding sphere
+    float boundsRadius;
+    float texCoordDensity;  // texture coordinate units per object space unit, averaged over the surface
+    VertexLayout layout;
+    PositionQuantization quantization;     // identity for the float layout
+    QuantizationError quantizationError;   // quantized layout: largest deviation from the float vertices
+    size_t vertexBytes;                    // size of the uploaded vertex buffer
+    size_t positionBytes;                  // ... and of the position-only one
+    GLenum indexType;                      // narrowest type that can address every vertex
+    size_t indexBytes;
+    // constructor; move the geometry in to avoid copying it, it is freed after the upload unless kept.
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures,
+         const MaterialParameters &parameters = MaterialParameters(), vector<MeshLod> lods = vector<MeshLod>(),
+         VertexLayout layout = VertexLayout::Float, GeometryRetention retention = GeometryRetention::Release)
     {
-        this->vertices = vertices;
-        this->indices = indices;
-        this->textures = textures;
+        this->textures = std::move(textures);
+        this->lods = std::move(lods);
+        material = Material(this->textures, parameters);
 
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
+        setupMesh(vertices.data(), vertices.size(), indices.data(), indices.size(), layout);
+        if (retention == GeometryRetention::Keep)
+        {
+            this->vertices = std::move(vertices);
+            this->indices = std::move(indices);
+        }
+    }
+
+    // constructor for geometry that lives elsewhere (e.g. a mapped mesh cache file); the data is uploaded
+    // straight from the given pointers and only copied when it is kept.
+    Mesh(const Vertex *vertexData, size_t vertexCount, const unsigned int *indexData, size_t indexCount, vector<Texture> textures,
+         const MaterialParameters &parameters = MaterialParameters(), vector<MeshLod> lods = vector<MeshLod>(),
+         VertexLayout layout = VertexLayout::Float, GeometryRetention retention = GeometryRetention::Release)
+    {
+        this->textures = std::move(textures);
+        this->lods = std::move(lods);
+        material = Material(this->textures, parameters);
+        setupMesh(vertexData, vertexCount, indexData, indexCount, layout);
+        if (retention == GeometryRetention::Keep)
+        {
+            vertices.assign(vertexData, vertexData + vertexCount);
+            indices.assign(indexData, indexData + indexCount);
+        }
     }
 
-    // render the mesh
-    void Draw(Shader &shader)
+    // picks the coarsest level whose simplification error projects to at most maxPixelError pixels
+    // when the mesh is drawn with the given model matrix.
+    unsigned int SelectLod(const glm::mat4 &model, const LodSelection &selection) const
     {
-        // bind appropriate textures
-        unsigned int diffuseNr  = 1;
-        unsigned int specularNr = 1;
-        unsigned int normalNr   = 1;
-        unsigned int heightNr   = 1;
-        for(unsigned int i = 0; i < textures.size(); i++)
+        float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+        glm::vec3 center = glm::vec3(model * glm::vec4(boundsCenter, 1.0f));
+        float distance = glm::length(center - selection.viewPosition) - boundsRadius * scale;
+        unsigned int level = 0;
+        if (distance > 0.0f)
         {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-            // retrieve texture number (the N in diffuse_textureN)
-            string number;
-            string name = textures[i].type;
-            if(name == "texture_diffuse")
-                number = std::to_string(diffuseNr++);
-            else if(name == "texture_specular")
-                number = std::to_string(specularNr++); // transfer unsigned int to stream
-            else if(name == "texture_normal")
-                number = std::to_string(normalNr++); // transfer unsigned int to stream
-            else if(name == "texture_height")
-                number = std::to_string(heightNr++); // transfer unsigned int to stream
-
-            // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (glslIdentifierPrefix + name + number).c_str()), i);
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+            float pixelsPerUnit = selection.pixelsPerUnit / distance;
+            while (level + 1 < lods.size() && lods[level + 1].error * scale * pixelsPerUnit <= selection.maxPixelError)
+                level++;
         }
+        return std::min(level + selection.bias, (unsigned int)lods.size() - 1);
+    }
+
+    // texture coordinate units covered by one screen pixel where the mesh is closest to the viewer, which
+    // decides the finest texture mip level worth keeping resident (see TextureResidency).
+    float TexCoordsPerPixel(const glm::mat4 &model, const LodSelection &selection) const
+    {
+        float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+        glm::vec3 center = glm::vec3(model * glm::vec4(boundsCenter, 1.0f));
+        float distance = glm::length(center - selection.viewPosition) - boundsRadius * scale;
+        if (distance <= 0.0f || scale <= 0.0f)
+            return 0.0f;
+        return texCoordDensity * distance / (scale * selection.pixelsPerUnit);
+    }
+
+    // render the mesh at the given level of detail. Transparent materials are blended over what was drawn before
+    // and leave the depth buffer alone; ordering them back to front is up to the caller, see RenderQueue.
+    void Draw(Shader &shader, unsigned int lod = 0)
+    {
+        // the sampler uniforms point at fixed units (see BindMaterialSamplers), only the textures change
+        material.Bind();
 
+        // quantized positions are stored relative to the mesh bounds, see vertex_format.h
+        SetVertexUniforms(shader);
+        static const Uniform<bool> quantizedNormals("quantizedNormals");
+        shader.set(quantizedNormals, layout == VertexLayout::Quantized);
 
+        bool transparent = material.Transparent();
+        if (transparent)
+        {
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            glDepthMask(GL_FALSE);
+        }
 
         // draw mesh
+        const MeshLod &level = lods[std::min(lod, (unsigned int)lods.size() - 1)];
         glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+        glDrawElements(GL_TRIANGLES, level.indexCount, indexType, (void*)(level.indexOffset * indexSize()));
         glBindVertexArray(0);
 
+        if (transparent)
+        {
+            glDisable(GL_BLEND);
+            glDepthMask(GL_TRUE);
+        }
+
         // always good practice to set everything back to defaults once configured.
         glActiveTexture(GL_TEXTURE0);
     }
 
+    // render only the positions, for depth passes that neither sample textures nor read other attributes
+    void DrawDepth(Shader &shader, unsigned int lod = 0)
+    {
+        SetVertexUniforms(shader);
+
+        const MeshLod &level = lods[std::min(lod, (unsigned int)lods.size() - 1)];
+        glBindVertexArray(depthVAO);
+        glDrawElements(GL_TRIANGLES, level.indexCount, indexType, (void*)(level.indexOffset * indexSize()));
+        glBindVertexArray(0);
+    }
+
+    // the pieces of Draw and DrawDepth for RenderQueue (see render_queue.h), which binds the material and the
+    // vertex array itself, and only when they differ from the previous draw's.
+    unsigned int VertexArray(bool depthOnly) const
+    {
+        return depthOnly ? depthVAO : VAO;
+    }
+
+    // the uniforms that decode this mesh's positions, see vertex_format.h
+    void SetVertexUniforms(const Shader &shader) const
+    {
+        static const Uniform<glm::vec3> positionOffset("positionOffset");
+        static const Uniform<float> positionScale("positionScale");
+        shader.set(positionOffset, quantization.offset);
+        shader.set(positionScale, quantization.scale);
+    }
+
+    // issues the draw call; the mesh's vertex array must be bound.
+    void DrawElements(unsigned int lod) const
+    {
+        const MeshLod &level = lods[std::min(lod, (unsigned int)lods.size() - 1)];
+        glDrawElements(GL_TRIANGLES, level.indexCount, indexType, (void*)(level.indexOffset * indexSize()));
+    }
+
+    // CPU memory held by the mesh, including the object itself.
+    size_t CpuBytes() const
+    {
+        size_t bytes = sizeof(Mesh) + vertices.capacity() * sizeof(Vertex) + indices.capacity() * sizeof(unsigned int)
+                       + lods.capacity() * sizeof(MeshLod) + textures.capacity() * sizeof(Texture);
+        for (const Texture &texture : textures)
+            bytes += texture.type.capacity() + texture.path.capacity();
+        return bytes;
+    }
+
+    // GPU memory of the vertex, position and index buffers.
+    size_t GpuBytes() const
+    {
+        return vertexBytes + positionBytes + indexBytes;
+    }
+
+    // deletes the GL objects of the mesh. Meshes are copied around by value, so this is left to the owning Model.
+    void Release()
+    {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteVertexArrays(1, &depthVAO);
+        unsigned int buffers[] = {VBO, EBO, positionVBO};
+        glDeleteBuffers(3, buffers);
+        VAO = depthVAO = VBO = EBO = positionVBO = 0;
+        material.Release();
+    }
+
 private:
     // render data
-    unsigned int VBO, EBO;
+    unsigned int VBO, EBO, positionVBO;
+
+    size_t indexSize() const
+    {
+        return indexType == GL_UNSIGNED_BYTE ? 1 : indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+    }
+
+    template <typename T>
+    static vector<T> narrowIndices(const unsigned int *indexData, size_t indexCount)
+    {
+        return vector<T>(indexData, indexData + indexCount);
+    }
 
     // initializes all the buffer objects/arrays
-    void setupMesh()
+    void setupMesh(const Vertex *vertexData, size_t vertexCount, const unsigned int *indexData, size_t indexCount, VertexLayout layout)
     {
+        this->layout = layout;
+        this->indexCount = indexCount;
+        if (lods.empty())
+            lods.push_back({0, (unsigned int)indexCount, 0.0f});
+
+        // bounding sphere around the box centre
+        glm::vec3 lo(0.0f), hi(0.0f);
+        if (vertexCount > 0)
+            lo = hi = vertexData[0].Position;
+        for (size_t i = 1; i < vertexCount; i++)
+        {
+            const glm::vec3 &p = vertexData[i].Position;
+            lo = glm::vec3(std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z));
+            hi = glm::vec3(std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z));
+        }
+        boundsCenter = (lo + hi) * 0.5f;
+        boundsRadius = 0.0f;
+        for (size_t i = 0; i < vertexCount; i++)
+            boundsRadius = std::max(boundsRadius, glm::length(vertexData[i].Position - boundsCenter));
+        // ratio of texture to surface area over the full level of detail
+        double surfaceArea = 0.0, texCoordArea = 0.0;
+        for (size_t i = 0; i + 2 < lods[0].indexCount; i += 3)
+        {
+            const Vertex &a = vertexData[indexData[i]], &b = vertexData[indexData[i + 1]], &c = vertexData[indexData[i + 2]];
+            surfaceArea += glm::length(glm::cross(b.Position - a.Position, c.Position - a.Position));
+            glm::vec2 u = b.TexCoords - a.TexCoords, v = c.TexCoords - a.TexCoords;
+            texCoordArea += fabs(u.x * v.y - u.y * v.x);
+        }
+        texCoordDensity = surfaceArea > 0.0 ? (float)sqrt(texCoordArea / surfaceArea) : 0.0f;
+
         // create buffers/arrays
         glGenVertexArrays(1, &VAO);
         glGenBuffers(1, &VBO);
@@ -108,30 +278,68 @@ private:
         glBindVertexArray(VAO);
         // load data into vertex buffers
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        // A great thing about structs is that their memory layout is sequential for all its items.
-        // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
-        // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+        VertexFormat format = VertexFormat::Get(layout);
+        vertexBytes = vertexCount * format.stride;
+        vector<PackedVertex> packed;
+        if (layout == VertexLayout::Quantized)
+        {
+            quantization = ComputePositionQuantization(vertexData, vertexCount);
+            packed = PackVertices(vertexData, vertexCount, quantization);
+            quantizationError = MeasureQuantizationError(vertexData, packed.data(), vertexCount, quantization);
+            // a mesh the packed format cannot represent within the tolerances (e.g. half float UVs tiling well
+            // beyond [0, 1]) keeps the float layout, so the quantized layout never changes what is drawn
+            if (!quantizationError.withinTolerance())
+            {
+                layout = this->layout = VertexLayout::Float;
+                format = VertexFormat::Get(layout);
+                vertexBytes = vertexCount * format.stride;
+                quantizationError = QuantizationError();
+                packed.clear();
+            }
+        }
+        if (layout == VertexLayout::Quantized)
+            glBufferData(GL_ARRAY_BUFFER, vertexBytes, packed.data(), GL_STATIC_DRAW);
+        else
+        {
+            quantization = {glm::vec3(0.0f), 1.0f};
+            // A great thing about structs is that their memory layout is sequential for all its items.
+            // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
+            // again translates to 3/2 floats which translates to a byte array.
+            glBufferData(GL_ARRAY_BUFFER, vertexBytes, vertexData, GL_STATIC_DRAW);
+        }
 
+        // indices are narrowed to 8 or 16 bits whenever the vertex count allows it (see SplitMesh)
+        indexType = vertexCount <= 256 ? GL_UNSIGNED_BYTE : vertexCount <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        indexBytes = indexCount * indexSize();
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        if (indexType == GL_UNSIGNED_BYTE)
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, narrowIndices<unsigned char>(indexData, indexCount).data(), GL_STATIC_DRAW);
+        else if (indexType == GL_UNSIGNED_SHORT)
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, narrowIndices<unsigned short>(indexData, indexCount).data(), GL_STATIC_DRAW);
+        else
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, indexData, GL_STATIC_DRAW);
 
         // set the vertex attribute pointers
-        // vertex Positions
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        // vertex normals
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-        // vertex texture coords
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-        // vertex tangent
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
-        // vertex bitangent
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+        format.Apply();
+
+        // the depth VAO reads the same positions from a buffer that holds nothing else
+        VertexFormat positionFormat = VertexFormat::Positions(layout);
+        positionBytes = vertexCount * positionFormat.stride;
+        vector<char> positions(positionBytes);
+        for (size_t i = 0; i < vertexCount; i++)
+        {
+            if (layout == VertexLayout::Quantized)
+                memcpy(&positions[i * positionFormat.stride], packed[i].Position, positionFormat.stride);
+            else
+                memcpy(&positions[i * positionFormat.stride], &vertexData[i].Position, positionFormat.stride);
+        }
+        glGenVertexArrays(1, &depthVAO);
+        glGenBuffers(1, &positionVBO);
+        glBindVertexArray(depthVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, positionVBO);
+        glBufferData(GL_ARRAY_BUFFER, positionBytes, positions.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        positionFormat.Apply();
 
         glBindVertexArray(0);
     }
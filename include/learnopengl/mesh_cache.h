@@ -0,0 +1,382 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <learnopengl/asset_cache.h>
+#include <learnopengl/mesh.h>
+#include <learnopengl/vfs.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Binary cache of fully processed mesh data, so a warm start can skip Assimp entirely.
+//
+// File layout (native endianness, every section aligned to MESH_CACHE_ALIGNMENT):
+//   MeshCacheHeader
+//   MeshCacheRecord[meshCount]
+//   MeshCacheTextureRef[textureCount]
+//   MeshLod[lodCount]
+//   MeshCacheDependency[dependencyCount]
+//   string blob (source path, texture types and paths, dependency paths)
+//   vertex blob (interleaved Vertex, ready for glBufferData)
+//   index blob (unsigned int, ready for glBufferData; all LODs of a mesh back to back)
+//
+// A cache file is only used when magic, version, vertex size, source path, source mtime/size, import flags and
+// the mtime/size of every file the import read besides the source (material libraries) all match. Bump
+// MESH_CACHE_VERSION whenever the processing pipeline changes its output.
+
+const uint32_t MESH_CACHE_VERSION = 7; // 2: index/vertex buffers run through mesh_optimizer.h, 3: welded vertices and LODs,
+                                       // 4: meshes split to fit 16-bit indices, 5: OBJ files read by obj_loader.h,
+                                       // 6: dependencies, 7: material parameters
+const uint64_t MESH_CACHE_ALIGNMENT = 16;
+
+struct MeshCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t vertexSize;
+    uint32_t importFlags;
+    int64_t sourceMtime;
+    uint64_t sourceSize;
+    uint32_t meshCount;
+    uint32_t textureCount;
+    uint32_t lodCount;
+    uint32_t dependencyCount;
+    uint64_t recordsOffset;
+    uint64_t texturesOffset;
+    uint64_t lodsOffset;
+    uint64_t dependenciesOffset;
+    uint64_t stringsOffset;
+    uint64_t sourcePathOffset;
+    uint32_t sourcePathLength;
+    float coldLoadMilliseconds; // Assimp import + processing time of the run that wrote this file
+};
+
+struct MeshCacheRecord {
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t firstTexture;
+    uint32_t textureCount;
+    uint32_t firstLod;
+    uint32_t lodCount;
+    float shininess; // MaterialParameters
+    float opacity;
+};
+
+struct MeshCacheTextureRef {
+    uint64_t typeOffset;
+    uint64_t pathOffset;
+    uint32_t typeLength;
+    uint32_t pathLength;
+};
+
+// a file the import read besides the source, as it was when the cache was written
+struct MeshCacheDependency {
+    uint64_t pathOffset;
+    uint32_t pathLength;
+    uint32_t exists; // a missing material library that appears later invalidates the cache as well
+    int64_t mtime;
+    uint64_t size;
+};
+
+// CPU-side result of processing one mesh, before anything is uploaded.
+struct MeshData {
+    vector<Vertex>       vertices;
+    vector<unsigned int> indices;
+    vector<Texture>      textures; // only type and path are meaningful until the textures are loaded
+    vector<MeshLod>      lods;     // ranges of indices, see mesh_simplifier.h
+    MaterialParameters   material;
+};
+
+inline uint64_t meshCacheAlign(uint64_t offset)
+{
+    return (offset + MESH_CACHE_ALIGNMENT - 1) & ~(MESH_CACHE_ALIGNMENT - 1);
+}
+
+// how Model::Import uses the mesh cache
+enum class MeshCacheMode {
+    ReadWrite, // map a valid cache file, otherwise import and write one
+    Refresh,   // always import, then write the result (for when files the cache does not track may have changed)
+    Bypass     // import without touching the cache, e.g. to time the import itself
+};
+
+inline string MeshCachePath(const string &sourcePath, const string &variant)
+{
+    return AssetCachePath(variant.empty() ? sourcePath : sourcePath + '#' + variant, "lmc");
+}
+
+// Read-only memory mapping of a validated cache file. Pointers returned by vertices()/indices()
+// stay valid until the object is destroyed.
+class MeshCacheFile
+{
+public:
+    MeshCacheFile() : data(nullptr), size(0) {}
+    ~MeshCacheFile() { close(); }
+    MeshCacheFile(const MeshCacheFile &) = delete;
+    MeshCacheFile &operator=(const MeshCacheFile &) = delete;
+
+    // maps the cache entry for sourcePath and checks that it is still valid for the source file, the files it
+    // depends on and the import flags.
+    // Each variant (an import profile, see import_profile.h) of the same source has its own entry.
+    bool open(const string &sourcePath, unsigned int importFlags, const string &variant = string())
+    {
+        close();
+        int64_t mtime;
+        uint64_t sourceSize;
+        if (!VirtualFileSystem::Instance().Stat(sourcePath, mtime, sourceSize))
+            return false;
+
+        int fd = ::open(MeshCachePath(sourcePath, variant).c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat info;
+        if (fstat(fd, &info) != 0 || (uint64_t)info.st_size < sizeof(MeshCacheHeader))
+        {
+            ::close(fd);
+            return false;
+        }
+        size = (size_t)info.st_size;
+        void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED)
+        {
+            size = 0;
+            return false;
+        }
+        data = (const char *)mapping;
+
+        const MeshCacheHeader &h = header();
+        bool valid = memcmp(h.magic, "LMC1", 4) == 0
+                     && h.version == MESH_CACHE_VERSION
+                     && h.vertexSize == sizeof(Vertex)
+                     && h.importFlags == importFlags
+                     && h.sourceMtime == mtime
+                     && h.sourceSize == sourceSize
+                     && h.recordsOffset + (uint64_t)h.meshCount * sizeof(MeshCacheRecord) <= size
+                     && h.texturesOffset + (uint64_t)h.textureCount * sizeof(MeshCacheTextureRef) <= size
+                     && h.lodsOffset + (uint64_t)h.lodCount * sizeof(MeshLod) <= size
+                     && h.dependenciesOffset + (uint64_t)h.dependencyCount * sizeof(MeshCacheDependency) <= size
+                     && h.sourcePathOffset + h.sourcePathLength <= size
+                     && string(data + h.sourcePathOffset, h.sourcePathLength) == sourcePath;
+        for (uint32_t i = 0; valid && i < h.dependencyCount; i++)
+        {
+            const MeshCacheDependency &d = ((const MeshCacheDependency *)(data + h.dependenciesOffset))[i];
+            int64_t dependencyMtime = 0;
+            uint64_t dependencySize = 0;
+            valid = d.pathOffset + d.pathLength <= size;
+            bool exists = valid && VirtualFileSystem::Instance().Stat(string(data + d.pathOffset, d.pathLength), dependencyMtime, dependencySize);
+            valid = valid && exists == (d.exists != 0) && (!exists || (dependencyMtime == d.mtime && dependencySize == d.size));
+        }
+        for (uint32_t i = 0; valid && i < h.meshCount; i++)
+        {
+            const MeshCacheRecord &r = record(i);
+            valid = r.vertexOffset + (uint64_t)r.vertexCount * sizeof(Vertex) <= size
+                    && r.indexOffset + (uint64_t)r.indexCount * sizeof(unsigned int) <= size
+                    && r.firstTexture + r.textureCount <= h.textureCount
+                    && r.firstLod + r.lodCount <= h.lodCount;
+            for (uint32_t l = r.firstLod; valid && l < r.firstLod + r.lodCount; l++)
+            {
+                const MeshLod &lod = ((const MeshLod *)(data + h.lodsOffset))[l];
+                valid = (uint64_t)lod.indexOffset + lod.indexCount <= r.indexCount;
+            }
+        }
+        if (!valid)
+            close();
+        return valid;
+    }
+
+    void close()
+    {
+        if (data)
+            munmap((void *)data, size);
+        data = nullptr;
+        size = 0;
+    }
+
+    const MeshCacheHeader &header() const { return *(const MeshCacheHeader *)data; }
+    unsigned int meshCount() const { return header().meshCount; }
+    const MeshCacheRecord &record(unsigned int mesh) const
+    {
+        return ((const MeshCacheRecord *)(data + header().recordsOffset))[mesh];
+    }
+    const Vertex *vertices(unsigned int mesh) const { return (const Vertex *)(data + record(mesh).vertexOffset); }
+    const unsigned int *indices(unsigned int mesh) const { return (const unsigned int *)(data + record(mesh).indexOffset); }
+    vector<MeshLod> lods(unsigned int mesh) const
+    {
+        const MeshLod *first = (const MeshLod *)(data + header().lodsOffset) + record(mesh).firstLod;
+        return vector<MeshLod>(first, first + record(mesh).lodCount);
+    }
+
+    MaterialParameters material(unsigned int mesh) const
+    {
+        MaterialParameters parameters;
+        parameters.shininess = record(mesh).shininess;
+        parameters.opacity = record(mesh).opacity;
+        return parameters;
+    }
+
+    // texture references of a mesh; ids are left at 0 for the caller to resolve.
+    vector<Texture> textures(unsigned int mesh) const
+    {
+        vector<Texture> result;
+        const MeshCacheRecord &r = record(mesh);
+        const MeshCacheTextureRef *refs = (const MeshCacheTextureRef *)(data + header().texturesOffset);
+        for (uint32_t i = r.firstTexture; i < r.firstTexture + r.textureCount; i++)
+        {
+            Texture texture;
+            texture.id = 0;
+            texture.type = string(data + refs[i].typeOffset, refs[i].typeLength);
+            texture.path = string(data + refs[i].pathOffset, refs[i].pathLength);
+            result.push_back(texture);
+        }
+        return result;
+    }
+
+private:
+    const char *data;
+    size_t size;
+};
+
+// writes the processed meshes of sourcePath to its cache file, along with the state of the other files the import
+// read (dependencies). The file is written under a temporary name and renamed into place, so readers never
+// observe a partially written cache.
+inline bool WriteMeshCache(const string &sourcePath, unsigned int importFlags, const vector<MeshData> &meshes, float coldLoadMilliseconds,
+                           const string &variant = string(), const vector<string> &dependencies = vector<string>())
+{
+    MeshCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "LMC1", 4);
+    header.version = MESH_CACHE_VERSION;
+    header.vertexSize = sizeof(Vertex);
+    header.importFlags = importFlags;
+    header.coldLoadMilliseconds = coldLoadMilliseconds;
+    if (!VirtualFileSystem::Instance().Stat(sourcePath, header.sourceMtime, header.sourceSize))
+        return false;
+
+    // lay out the string blob first so that records can point into it
+    vector<MeshCacheTextureRef> refs;
+    vector<MeshLod> lods;
+    string strings = sourcePath;
+    vector<MeshCacheRecord> records(meshes.size());
+    for (size_t i = 0; i < meshes.size(); i++)
+    {
+        records[i].firstTexture = (uint32_t)refs.size();
+        records[i].textureCount = (uint32_t)meshes[i].textures.size();
+        records[i].firstLod = (uint32_t)lods.size();
+        records[i].lodCount = (uint32_t)meshes[i].lods.size();
+        records[i].shininess = meshes[i].material.shininess;
+        records[i].opacity = meshes[i].material.opacity;
+        lods.insert(lods.end(), meshes[i].lods.begin(), meshes[i].lods.end());
+        for (const Texture &texture : meshes[i].textures)
+        {
+            MeshCacheTextureRef ref;
+            ref.typeOffset = strings.size();
+            ref.typeLength = (uint32_t)texture.type.size();
+            strings += texture.type;
+            ref.pathOffset = strings.size();
+            ref.pathLength = (uint32_t)texture.path.size();
+            strings += texture.path;
+            refs.push_back(ref);
+        }
+    }
+    vector<MeshCacheDependency> dependencyRecords(dependencies.size());
+    for (size_t i = 0; i < dependencies.size(); i++)
+    {
+        MeshCacheDependency &d = dependencyRecords[i];
+        memset(&d, 0, sizeof(d));
+        int64_t mtime;
+        uint64_t dependencySize;
+        if (VirtualFileSystem::Instance().Stat(dependencies[i], mtime, dependencySize))
+        {
+            d.exists = 1;
+            d.mtime = mtime;
+            d.size = dependencySize;
+        }
+        d.pathOffset = strings.size();
+        d.pathLength = (uint32_t)dependencies[i].size();
+        strings += dependencies[i];
+    }
+
+    header.meshCount = (uint32_t)meshes.size();
+    header.textureCount = (uint32_t)refs.size();
+    header.lodCount = (uint32_t)lods.size();
+    header.dependencyCount = (uint32_t)dependencyRecords.size();
+    header.recordsOffset = meshCacheAlign(sizeof(MeshCacheHeader));
+    header.texturesOffset = meshCacheAlign(header.recordsOffset + records.size() * sizeof(MeshCacheRecord));
+    header.lodsOffset = meshCacheAlign(header.texturesOffset + refs.size() * sizeof(MeshCacheTextureRef));
+    header.dependenciesOffset = meshCacheAlign(header.lodsOffset + lods.size() * sizeof(MeshLod));
+    header.stringsOffset = meshCacheAlign(header.dependenciesOffset + dependencyRecords.size() * sizeof(MeshCacheDependency));
+    header.sourcePathOffset = header.stringsOffset;
+    header.sourcePathLength = (uint32_t)sourcePath.size();
+    for (MeshCacheTextureRef &ref : refs)
+    {
+        ref.typeOffset += header.stringsOffset;
+        ref.pathOffset += header.stringsOffset;
+    }
+    for (MeshCacheDependency &d : dependencyRecords)
+        d.pathOffset += header.stringsOffset;
+    uint64_t offset = meshCacheAlign(header.stringsOffset + strings.size());
+    for (size_t i = 0; i < meshes.size(); i++)
+    {
+        records[i].vertexOffset = offset;
+        records[i].vertexCount = (uint32_t)meshes[i].vertices.size();
+        offset = meshCacheAlign(offset + meshes[i].vertices.size() * sizeof(Vertex));
+        records[i].indexOffset = offset;
+        records[i].indexCount = (uint32_t)meshes[i].indices.size();
+        offset = meshCacheAlign(offset + meshes[i].indices.size() * sizeof(unsigned int));
+    }
+
+    AssetCacheCreateDirectory();
+    string path = MeshCachePath(sourcePath, variant);
+    string temporaryPath = path + ".tmp" + to_string(getpid());
+    ofstream out(temporaryPath, ios::binary | ios::trunc);
+    if (!out)
+    {
+        cout << "ERROR::MESH_CACHE:: could not write " << temporaryPath << endl;
+        return false;
+    }
+    static const char padding[MESH_CACHE_ALIGNMENT] = {};
+    auto pad = [&out](uint64_t target) {
+        uint64_t position = (uint64_t)out.tellp();
+        if (target > position)
+            out.write(padding, target - position);
+    };
+    out.write((const char *)&header, sizeof(header));
+    pad(header.recordsOffset);
+    out.write((const char *)records.data(), records.size() * sizeof(MeshCacheRecord));
+    pad(header.texturesOffset);
+    out.write((const char *)refs.data(), refs.size() * sizeof(MeshCacheTextureRef));
+    pad(header.lodsOffset);
+    out.write((const char *)lods.data(), lods.size() * sizeof(MeshLod));
+    pad(header.dependenciesOffset);
+    out.write((const char *)dependencyRecords.data(), dependencyRecords.size() * sizeof(MeshCacheDependency));
+    pad(header.stringsOffset);
+    out.write(strings.data(), strings.size());
+    for (size_t i = 0; i < meshes.size(); i++)
+    {
+        pad(records[i].vertexOffset);
+        out.write((const char *)meshes[i].vertices.data(), meshes[i].vertices.size() * sizeof(Vertex));
+        pad(records[i].indexOffset);
+        out.write((const char *)meshes[i].indices.data(), meshes[i].indices.size() * sizeof(unsigned int));
+    }
+    out.close();
+    if (!out || rename(temporaryPath.c_str(), path.c_str()) != 0)
+    {
+        cout << "ERROR::MESH_CACHE:: could not write " << path << endl;
+        remove(temporaryPath.c_str());
+        return false;
+    }
+    return true;
+}
+#endif
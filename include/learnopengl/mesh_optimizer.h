@@ -0,0 +1,412 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <learnopengl/mesh.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+// Import-time index/vertex buffer optimizations, run on every mesh before it is cached and uploaded:
+//   0. WeldVertices        - merges identical vertices, which importers emit once per face corner; a separate
+//                            step (ImportProfile::weld), as OptimizeMesh works on whatever vertices it is given
+//   1. OptimizeVertexCache - reorders triangles for post-transform cache locality (Forsyth's linear-speed algorithm)
+//   2. OptimizeOverdraw    - reorders clusters of those triangles so outward facing geometry is drawn first
+//   3. OptimizeVertexFetch - renumbers vertices in order of first use, so vertex fetches walk memory linearly
+
+const unsigned int VERTEX_CACHE_ANALYZE_SIZE = 16; // FIFO size used for the reported statistics
+const int VERTEX_CACHE_OPTIMIZE_SIZE = 32;          // LRU size the optimizer targets
+const size_t SHORT_INDEX_VERTEX_LIMIT = 65536;      // meshes above this are split by SplitMesh
+
+// post-transform cache simulation counts; accumulate several meshes by adding them up.
+struct VertexCacheStatistics {
+    size_t misses = 0;    // vertices transformed
+    size_t triangles = 0;
+    size_t vertices = 0;  // distinct vertices referenced
+
+    // average cache miss ratio: transformed vertices per triangle (0.5 is ideal for large grids, 3 is the worst)
+    float ACMR() const { return triangles ? (float)misses / triangles : 0.0f; }
+    // average transform to vertex ratio: transformed vertices per distinct vertex (1 is ideal)
+    float ATVR() const { return vertices ? (float)misses / vertices : 0.0f; }
+
+    VertexCacheStatistics &operator+=(const VertexCacheStatistics &other)
+    {
+        misses += other.misses;
+        triangles += other.triangles;
+        vertices += other.vertices;
+        return *this;
+    }
+};
+
+// simulates a FIFO post-transform cache over a triangle list.
+inline VertexCacheStatistics AnalyzeVertexCache(const vector<unsigned int> &indices, size_t vertexCount, unsigned int cacheSize = VERTEX_CACHE_ANALYZE_SIZE)
+{
+    VertexCacheStatistics statistics;
+    statistics.triangles = indices.size() / 3;
+    // a vertex is in the cache while fewer than cacheSize misses happened since it was last loaded
+    vector<size_t> loadedAt(vertexCount, 0);
+    vector<bool> referenced(vertexCount, false);
+    size_t time = cacheSize + 1;
+    for (unsigned int index : indices)
+    {
+        if (time - loadedAt[index] > cacheSize)
+        {
+            loadedAt[index] = time++;
+            statistics.misses++;
+        }
+        if (!referenced[index])
+        {
+            referenced[index] = true;
+            statistics.vertices++;
+        }
+    }
+    return statistics;
+}
+
+inline float forsythVertexScore(int cachePosition, unsigned int liveTriangles)
+{
+    if (liveTriangles == 0)
+        return -1.0f; // no triangles left, never pick
+    float score = 0.0f;
+    if (cachePosition >= 0)
+    {
+        // the three vertices of the last triangle get a fixed score so that strips are not favoured over fans
+        if (cachePosition < 3)
+            score = 0.75f;
+        else
+            score = powf(1.0f - (float)(cachePosition - 3) / (VERTEX_CACHE_OPTIMIZE_SIZE - 3), 1.5f);
+    }
+    // boost vertices with few triangles left so they get finished off and leave the working set
+    return score + 2.0f / sqrtf((float)liveTriangles);
+}
+
+// reorders the triangles of a triangle list to make good use of the post-transform vertex cache.
+inline void OptimizeVertexCache(vector<unsigned int> &indices, size_t vertexCount)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount < 2)
+        return;
+
+    // vertex -> triangle adjacency; the first live[v] entries of each list are the triangles not yet emitted
+    vector<unsigned int> live(vertexCount, 0);
+    for (unsigned int index : indices)
+        live[index]++;
+    vector<size_t> adjacencyOffset(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++)
+        adjacencyOffset[v + 1] = adjacencyOffset[v] + live[v];
+    vector<unsigned int> adjacency(indices.size());
+    {
+        vector<size_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+        for (size_t t = 0; t < triangleCount; t++)
+            for (int k = 0; k < 3; k++)
+                adjacency[fill[indices[t * 3 + k]]++] = (unsigned int)t;
+    }
+
+    vector<int> cachePosition(vertexCount, -1);
+    vector<float> vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+        vertexScore[v] = forsythVertexScore(-1, live[v]);
+    vector<float> triangleScore(triangleCount);
+    vector<bool> emitted(triangleCount, false);
+    for (size_t t = 0; t < triangleCount; t++)
+        triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+
+    vector<unsigned int> result;
+    result.reserve(indices.size());
+    unsigned int cache[VERTEX_CACHE_OPTIMIZE_SIZE + 3];
+    int cacheCount = 0;
+    size_t scanCursor = 0;
+
+    // start with the best scoring triangle overall
+    long best = 0;
+    for (size_t t = 1; t < triangleCount; t++)
+        if (triangleScore[t] > triangleScore[best])
+            best = (long)t;
+
+    while (best >= 0)
+    {
+        const unsigned int *triangle = &indices[best * 3];
+        emitted[best] = true;
+        for (int k = 0; k < 3; k++)
+        {
+            unsigned int v = triangle[k];
+            result.push_back(v);
+            // remove the triangle from the vertex' live list
+            unsigned int *list = &adjacency[adjacencyOffset[v]];
+            for (unsigned int i = 0; i < live[v]; i++)
+                if (list[i] == (unsigned int)best)
+                {
+                    std::swap(list[i], list[live[v] - 1]);
+                    break;
+                }
+            live[v]--;
+        }
+
+        // move the triangle's vertices to the front of the LRU cache
+        unsigned int newCache[VERTEX_CACHE_OPTIMIZE_SIZE + 3];
+        int newCount = 0;
+        for (int k = 0; k < 3; k++)
+        {
+            bool duplicate = false;
+            for (int i = 0; i < newCount; i++)
+                duplicate = duplicate || newCache[i] == triangle[k];
+            if (!duplicate)
+                newCache[newCount++] = triangle[k];
+        }
+        for (int i = 0; i < cacheCount; i++)
+        {
+            unsigned int v = cache[i];
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+                newCache[newCount++] = v;
+        }
+        // entries past the cache size are evicted; they are rescored once more below
+        for (int i = 0; i < newCount; i++)
+            cachePosition[newCache[i]] = i < VERTEX_CACHE_OPTIMIZE_SIZE ? i : -1;
+
+        // rescore every vertex whose cache position changed, and with it the live triangles using them
+        for (int i = 0; i < newCount; i++)
+        {
+            unsigned int v = newCache[i];
+            float score = forsythVertexScore(cachePosition[v], live[v]);
+            float delta = score - vertexScore[v];
+            vertexScore[v] = score;
+            const unsigned int *list = &adjacency[adjacencyOffset[v]];
+            for (unsigned int j = 0; j < live[v]; j++)
+                triangleScore[list[j]] += delta;
+        }
+        cacheCount = std::min(newCount, VERTEX_CACHE_OPTIMIZE_SIZE);
+        std::copy(newCache, newCache + cacheCount, cache);
+
+        // the next triangle is the best scoring live triangle using a cached vertex
+        best = -1;
+        for (int i = 0; i < cacheCount; i++)
+        {
+            const unsigned int *list = &adjacency[adjacencyOffset[cache[i]]];
+            for (unsigned int j = 0; j < live[cache[i]]; j++)
+                if (best < 0 || triangleScore[list[j]] > triangleScore[best])
+                    best = list[j];
+        }
+        if (best < 0)
+        {
+            // nothing in the cache has live triangles left, continue with the next unemitted triangle
+            while (scanCursor < triangleCount && emitted[scanCursor])
+                scanCursor++;
+            best = scanCursor < triangleCount ? (long)scanCursor : -1;
+        }
+    }
+    indices.swap(result);
+}
+
+// reorders the clusters of a cache optimized triangle list so that triangles facing away from the mesh
+// centre are drawn first and occlude the rest, while keeping the vertex cache hit rate within
+// threshold times the current one.
+inline void OptimizeOverdraw(vector<unsigned int> &indices, const vector<Vertex> &vertices, float threshold = 1.05f)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount < 16)
+        return;
+    float targetACMR = AnalyzeVertexCache(indices, vertices.size()).ACMR() * threshold;
+
+    // split into clusters: hard boundaries where a triangle misses the cache on all three vertices
+    // (a natural restart point), soft boundaries wherever the cluster's own ACMR is within the target
+    vector<size_t> clusterStarts;
+    vector<size_t> loadedAt(vertices.size(), 0);
+    size_t time = VERTEX_CACHE_ANALYZE_SIZE + 1;
+    size_t clusterMisses = 0, clusterStart = 0;
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        int misses = 0;
+        for (int k = 0; k < 3; k++)
+        {
+            unsigned int v = indices[t * 3 + k];
+            if (time - loadedAt[v] > VERTEX_CACHE_ANALYZE_SIZE)
+            {
+                loadedAt[v] = time++;
+                misses++;
+            }
+        }
+        if (t == 0 || misses == 3)
+        {
+            clusterStarts.push_back(t);
+            clusterStart = t;
+            clusterMisses = 0;
+        }
+        clusterMisses += misses;
+        size_t clusterTriangles = t + 1 - clusterStart;
+        if (clusterTriangles >= 8 && (float)clusterMisses / clusterTriangles <= targetACMR && t + 1 < triangleCount)
+        {
+            // start a fresh cluster with a flushed cache
+            clusterStarts.push_back(t + 1);
+            clusterStart = t + 1;
+            clusterMisses = 0;
+            time += VERTEX_CACHE_ANALYZE_SIZE + 1;
+        }
+    }
+    if (clusterStarts.size() < 2)
+        return;
+    clusterStarts.push_back(triangleCount);
+
+    // mesh centroid
+    glm::vec3 meshCentroid(0.0f);
+    for (const Vertex &vertex : vertices)
+        meshCentroid += vertex.Position;
+    meshCentroid = meshCentroid / (float)vertices.size();
+
+    struct Cluster {
+        size_t start, end;
+        float sortKey;
+    };
+    vector<Cluster> clusters;
+    for (size_t c = 0; c + 1 < clusterStarts.size(); c++)
+    {
+        glm::vec3 centroid(0.0f), normal(0.0f);
+        float area = 0.0f;
+        for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++)
+        {
+            const glm::vec3 &a = vertices[indices[t * 3]].Position;
+            const glm::vec3 &b = vertices[indices[t * 3 + 1]].Position;
+            const glm::vec3 &p = vertices[indices[t * 3 + 2]].Position;
+            glm::vec3 faceNormal = glm::cross(b - a, p - a); // length is twice the area
+            float faceArea = glm::length(faceNormal);
+            centroid += (a + b + p) * (faceArea / 3.0f);
+            normal += faceNormal;
+            area += faceArea;
+        }
+        centroid = area > 0.0f ? centroid / area : vertices[indices[clusterStarts[c] * 3]].Position;
+        float normalLength = glm::length(normal);
+        float key = normalLength > 0.0f ? glm::dot(centroid - meshCentroid, normal / normalLength) : 0.0f;
+        clusters.push_back({clusterStarts[c], clusterStarts[c + 1], key});
+    }
+    std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster &a, const Cluster &b) { return a.sortKey > b.sortKey; });
+
+    vector<unsigned int> result;
+    result.reserve(indices.size());
+    for (const Cluster &cluster : clusters)
+        result.insert(result.end(), indices.begin() + cluster.start * 3, indices.begin() + cluster.end * 3);
+    indices.swap(result);
+}
+
+// merges bitwise identical vertices. Assimp's OBJ reader emits one vertex per face corner, which leaves nothing
+// for the vertex cache to reuse and no connectivity for mesh_simplifier.h to work with.
+inline void WeldVertices(vector<Vertex> &vertices, vector<unsigned int> &indices)
+{
+    struct VertexHash {
+        size_t operator()(const Vertex *vertex) const
+        {
+            const unsigned char *bytes = (const unsigned char *)vertex;
+            size_t hash = 14695981039346656037ull;
+            for (size_t i = 0; i < sizeof(Vertex); i++)
+                hash = (hash ^ bytes[i]) * 1099511628211ull;
+            return hash;
+        }
+    };
+    struct VertexEqual {
+        bool operator()(const Vertex *a, const Vertex *b) const { return memcmp(a, b, sizeof(Vertex)) == 0; }
+    };
+    unordered_map<const Vertex *, unsigned int, VertexHash, VertexEqual> unique;
+    unique.reserve(vertices.size());
+    vector<unsigned int> remap(vertices.size());
+    vector<Vertex> result;
+    result.reserve(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        auto inserted = unique.emplace(&vertices[i], (unsigned int)result.size());
+        if (inserted.second)
+            result.push_back(vertices[i]);
+        remap[i] = inserted.first->second;
+    }
+    if (result.size() == vertices.size())
+        return;
+    for (unsigned int &index : indices)
+        index = remap[index];
+    vertices.swap(result);
+}
+
+struct MeshPart {
+    vector<Vertex>       vertices;
+    vector<unsigned int> indices;
+};
+
+// splits a mesh into parts of at most maxVertices vertices each, so every part can be drawn with 16-bit indices.
+// Triangles are taken in vertex cache order, which keeps the parts spatially compact; vertices on the cuts are
+// duplicated into both parts.
+inline vector<MeshPart> SplitMesh(const vector<Vertex> &vertices, const vector<unsigned int> &indices, size_t maxVertices = SHORT_INDEX_VERTEX_LIMIT)
+{
+    vector<MeshPart> parts;
+    if (vertices.size() <= maxVertices)
+    {
+        parts.push_back(MeshPart{vertices, indices});
+        return parts;
+    }
+    vector<unsigned int> ordered = indices;
+    OptimizeVertexCache(ordered, vertices.size());
+
+    const unsigned int unused = ~0u;
+    vector<unsigned int> remap(vertices.size(), unused);
+    vector<unsigned int> partVertices; // original indices of the current part's vertices
+    MeshPart part;
+    for (size_t t = 0; t + 2 < ordered.size(); t += 3)
+    {
+        size_t fresh = 0;
+        for (int k = 0; k < 3; k++)
+            fresh += remap[ordered[t + k]] == unused;
+        if (part.vertices.size() + fresh > maxVertices)
+        {
+            parts.push_back(std::move(part));
+            part = MeshPart();
+            for (unsigned int v : partVertices)
+                remap[v] = unused;
+            partVertices.clear();
+        }
+        for (int k = 0; k < 3; k++)
+        {
+            unsigned int v = ordered[t + k];
+            if (remap[v] == unused)
+            {
+                remap[v] = (unsigned int)part.vertices.size();
+                part.vertices.push_back(vertices[v]);
+                partVertices.push_back(v);
+            }
+            part.indices.push_back(remap[v]);
+        }
+    }
+    if (!part.indices.empty())
+        parts.push_back(std::move(part));
+    return parts;
+}
+
+// renumbers vertices in the order the index buffer first references them; unreferenced vertices are dropped.
+inline void OptimizeVertexFetch(vector<Vertex> &vertices, vector<unsigned int> &indices)
+{
+    const unsigned int unused = ~0u;
+    vector<unsigned int> remap(vertices.size(), unused);
+    vector<Vertex> result;
+    result.reserve(vertices.size());
+    for (unsigned int &index : indices)
+    {
+        if (remap[index] == unused)
+        {
+            remap[index] = (unsigned int)result.size();
+            result.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices.swap(result);
+}
+
+// runs steps 1-3 on one mesh and accumulates the cache statistics before and after. Welding is left to the
+// caller, see ImportProfile::weld.
+inline void OptimizeMesh(vector<Vertex> &vertices, vector<unsigned int> &indices, VertexCacheStatistics *before = nullptr, VertexCacheStatistics *after = nullptr)
+{
+    if (before)
+        *before += AnalyzeVertexCache(indices, vertices.size());
+    OptimizeVertexCache(indices, vertices.size());
+    OptimizeOverdraw(indices, vertices);
+    OptimizeVertexFetch(vertices, indices);
+    if (after)
+        *after += AnalyzeVertexCache(indices, vertices.size());
+}
+#endif
@@ -0,0 +1,300 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <learnopengl/mesh.h>
+#include <learnopengl/mesh_optimizer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+// Quadric error metric simplification used to build mesh LODs at import time.
+//
+// Edges are collapsed onto one of their existing endpoints, so every LOD is just another index buffer
+// over the mesh's vertex buffer. Vertices on open borders and on attribute seams (several vertices at one
+// position, e.g. UV or normal discontinuities) are never moved, which keeps silhouettes and texture
+// mapping intact at the cost of some reduction. Errors are reported relative to the mesh's bounding box
+// diagonal, so they can be turned into world or screen space distances by the caller.
+
+const unsigned int MESH_LOD_MAX_LEVELS = 4; // including the full detail level
+const float MESH_LOD_REDUCTION = 0.5f;      // each level targets this fraction of the previous level's triangles
+const float MESH_LOD_BASE_ERROR = 0.005f;   // error bound of the first reduced level relative to the mesh extent, doubled per level
+const float MESH_LOD_MIN_SAVING = 0.8f;     // levels keeping more than this fraction of the previous level are dropped
+
+// symmetric 4x4 plane quadric, stored as its upper triangle.
+struct Quadric {
+    double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+    double weight = 0; // sum of the plane weights
+
+    void addPlane(double a, double b, double c, double d, double weight)
+    {
+        a2 += weight * a * a; ab += weight * a * b; ac += weight * a * c; ad += weight * a * d;
+        b2 += weight * b * b; bc += weight * b * c; bd += weight * b * d;
+        c2 += weight * c * c; cd += weight * c * d;
+        d2 += weight * d * d;
+        this->weight += weight;
+    }
+
+    Quadric &operator+=(const Quadric &q)
+    {
+        a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad; b2 += q.b2; bc += q.bc; bd += q.bd; c2 += q.c2; cd += q.cd; d2 += q.d2;
+        weight += q.weight;
+        return *this;
+    }
+
+    // squared distance of point p to the accumulated planes, averaged over them by area, so it is in squared
+    // model units whatever the size of the triangles
+    double error(const glm::vec3 &p) const
+    {
+        double x = p.x, y = p.y, z = p.z;
+        double e = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+                   + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+                   + c2 * z * z + 2 * cd * z
+                   + d2;
+        return e > 0.0 && weight > 0.0 ? e / weight : 0.0;
+    }
+};
+
+inline void simplifierCross(const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c, double n[3])
+{
+    double ux = b.x - a.x, uy = b.y - a.y, uz = b.z - a.z;
+    double vx = c.x - a.x, vy = c.y - a.y, vz = c.z - a.z;
+    n[0] = uy * vz - uz * vy;
+    n[1] = uz * vx - ux * vz;
+    n[2] = ux * vy - uy * vx;
+}
+
+// bounding box diagonal of the vertices, the unit of the relative simplification error.
+inline float MeshExtent(const Vertex *vertices, size_t vertexCount)
+{
+    if (vertexCount == 0)
+        return 0.0f;
+    float lo[3] = {vertices[0].Position.x, vertices[0].Position.y, vertices[0].Position.z};
+    float hi[3] = {lo[0], lo[1], lo[2]};
+    for (size_t i = 1; i < vertexCount; i++)
+    {
+        const float p[3] = {vertices[i].Position.x, vertices[i].Position.y, vertices[i].Position.z};
+        for (int c = 0; c < 3; c++)
+        {
+            lo[c] = std::min(lo[c], p[c]);
+            hi[c] = std::max(hi[c], p[c]);
+        }
+    }
+    return sqrtf((hi[0] - lo[0]) * (hi[0] - lo[0]) + (hi[1] - lo[1]) * (hi[1] - lo[1]) + (hi[2] - lo[2]) * (hi[2] - lo[2]));
+}
+
+// reduces a triangle list towards targetIndexCount indices without exceeding targetError (relative to the mesh
+// extent). Returns the new index buffer; resultError receives the largest error actually introduced.
+inline vector<unsigned int> SimplifyMesh(const vector<Vertex> &vertices, const vector<unsigned int> &indices, size_t targetIndexCount,
+                                         float targetError, float *resultError = nullptr)
+{
+    size_t vertexCount = vertices.size();
+    vector<unsigned int> result = indices;
+    if (resultError)
+        *resultError = 0.0f;
+    float extent = MeshExtent(vertices.data(), vertexCount);
+    if (result.size() <= targetIndexCount || extent <= 0.0f)
+        return result;
+
+    // canonical vertex per position: the first vertex with bitwise identical coordinates
+    struct PositionKey {
+        uint32_t x, y, z;
+        bool operator==(const PositionKey &o) const { return x == o.x && y == o.y && z == o.z; }
+    };
+    struct PositionKeyHash {
+        size_t operator()(const PositionKey &k) const { return (k.x * 73856093u) ^ (k.y * 19349663u) ^ (k.z * 83492791u); }
+    };
+    unordered_map<PositionKey, unsigned int, PositionKeyHash> positionIds;
+    vector<unsigned int> position(vertexCount);
+    vector<unsigned int> verticesAtPosition(vertexCount, 0);
+    for (size_t i = 0; i < vertexCount; i++)
+    {
+        PositionKey key;
+        memcpy(&key.x, &vertices[i].Position.x, 4);
+        memcpy(&key.y, &vertices[i].Position.y, 4);
+        memcpy(&key.z, &vertices[i].Position.z, 4);
+        position[i] = positionIds.emplace(key, (unsigned int)i).first->second;
+        verticesAtPosition[position[i]]++;
+    }
+
+    // lock seam vertices and open border vertices (an edge without its opposite half-edge)
+    vector<bool> locked(vertexCount, false);
+    unordered_map<uint64_t, unsigned int> halfEdges;
+    for (size_t t = 0; t + 2 < result.size(); t += 3)
+        for (int k = 0; k < 3; k++)
+        {
+            uint64_t a = position[result[t + k]], b = position[result[t + (k + 1) % 3]];
+            halfEdges[(a << 32) | b]++;
+        }
+    for (const auto &edge : halfEdges)
+    {
+        uint64_t a = edge.first >> 32, b = edge.first & 0xFFFFFFFFull;
+        if (halfEdges.find((b << 32) | a) == halfEdges.end())
+            locked[a] = locked[b] = true;
+    }
+    for (size_t i = 0; i < vertexCount; i++)
+        if (verticesAtPosition[position[i]] > 1)
+            locked[position[i]] = true;
+
+    // accumulate the planes of all triangles around every position, weighted by triangle area
+    vector<Quadric> quadrics(vertexCount);
+    for (size_t t = 0; t + 2 < result.size(); t += 3)
+    {
+        const glm::vec3 &a = vertices[result[t]].Position;
+        double n[3];
+        simplifierCross(a, vertices[result[t + 1]].Position, vertices[result[t + 2]].Position, n);
+        double length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length <= 0.0)
+            continue;
+        n[0] /= length; n[1] /= length; n[2] /= length;
+        double d = -(n[0] * a.x + n[1] * a.y + n[2] * a.z);
+        for (int k = 0; k < 3; k++)
+            quadrics[position[result[t + k]]].addPlane(n[0], n[1], n[2], d, length * 0.5);
+    }
+
+    struct Collapse {
+        unsigned int from, to;
+        double cost;
+    };
+    double maxCost = (double)targetError * extent * targetError * extent;
+    float largestError = 0.0f;
+
+    // collapse in passes: each pass takes the cheapest independent collapses, then rebuilds the index buffer
+    for (int pass = 0; pass < 64 && result.size() > targetIndexCount; pass++)
+    {
+        // triangles around each vertex of the current index buffer
+        vector<unsigned int> triangleCount(vertexCount + 1, 0);
+        for (unsigned int index : result)
+            triangleCount[index + 1]++;
+        for (size_t i = 0; i < vertexCount; i++)
+            triangleCount[i + 1] += triangleCount[i];
+        vector<unsigned int> triangles(result.size());
+        {
+            vector<unsigned int> fill(triangleCount.begin(), triangleCount.end() - 1);
+            for (size_t i = 0; i < result.size(); i++)
+                triangles[fill[result[i]]++] = (unsigned int)(i / 3);
+        }
+
+        vector<Collapse> collapses;
+        for (size_t t = 0; t + 2 < result.size(); t += 3)
+            for (int k = 0; k < 3; k++)
+            {
+                unsigned int from = result[t + k], to = result[t + (k + 1) % 3];
+                for (int direction = 0; direction < 2; direction++, std::swap(from, to))
+                {
+                    if (locked[position[from]] || position[from] == position[to])
+                        continue;
+                    Quadric q = quadrics[position[from]];
+                    q += quadrics[position[to]];
+                    double cost = q.error(vertices[to].Position);
+                    if (cost <= maxCost)
+                        collapses.push_back({from, to, cost});
+                }
+            }
+        if (collapses.empty())
+            break;
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) { return a.cost < b.cost; });
+
+        vector<unsigned int> remap(vertexCount);
+        for (size_t i = 0; i < vertexCount; i++)
+            remap[i] = (unsigned int)i;
+        vector<bool> touched(vertexCount, false);
+        size_t removedIndices = 0;
+        size_t collapsed = 0;
+        for (const Collapse &collapse : collapses)
+        {
+            if (result.size() - removedIndices <= targetIndexCount)
+                break;
+            unsigned int from = collapse.from, to = collapse.to;
+            if (touched[position[from]] || touched[position[to]])
+                continue;
+
+            // reject collapses that flip or degenerate any remaining triangle around 'from'
+            bool valid = true;
+            size_t shared = 0;
+            for (unsigned int i = triangleCount[from]; i < triangleCount[from + 1] && valid; i++)
+            {
+                const unsigned int *triangle = &result[triangles[i] * 3];
+                if (position[triangle[0]] == position[to] || position[triangle[1]] == position[to] || position[triangle[2]] == position[to])
+                {
+                    shared++;
+                    continue;
+                }
+                glm::vec3 p[3], q[3];
+                for (int k = 0; k < 3; k++)
+                {
+                    p[k] = vertices[triangle[k]].Position;
+                    q[k] = triangle[k] == from ? vertices[to].Position : p[k];
+                }
+                double before[3], after[3];
+                simplifierCross(p[0], p[1], p[2], before);
+                simplifierCross(q[0], q[1], q[2], after);
+                double dot = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+                double lengths = sqrt(before[0] * before[0] + before[1] * before[1] + before[2] * before[2])
+                                 * sqrt(after[0] * after[0] + after[1] * after[1] + after[2] * after[2]);
+                valid = dot > 0.25 * lengths && lengths > 0.0;
+            }
+            if (!valid)
+                continue;
+
+            remap[from] = to;
+            quadrics[position[to]] += quadrics[position[from]];
+            largestError = std::max(largestError, (float)(sqrt(collapse.cost) / extent));
+            removedIndices += shared * 3;
+            collapsed++;
+            // freeze the whole neighbourhood for the rest of this pass so the flip checks above stay valid
+            for (unsigned int i = triangleCount[from]; i < triangleCount[from + 1]; i++)
+                for (int k = 0; k < 3; k++)
+                    touched[position[result[triangles[i] * 3 + k]]] = true;
+            touched[position[to]] = true;
+        }
+        if (collapsed == 0)
+            break;
+
+        vector<unsigned int> next;
+        next.reserve(result.size() - removedIndices);
+        for (size_t t = 0; t + 2 < result.size(); t += 3)
+        {
+            unsigned int a = remap[result[t]], b = remap[result[t + 1]], c = remap[result[t + 2]];
+            if (position[a] == position[b] || position[b] == position[c] || position[a] == position[c])
+                continue;
+            next.push_back(a);
+            next.push_back(b);
+            next.push_back(c);
+        }
+        result.swap(next);
+    }
+
+    if (resultError)
+        *resultError = largestError;
+    return result;
+}
+
+// appends up to MESH_LOD_MAX_LEVELS - 1 reduced versions of the (already optimized) index buffer to it and
+// describes every level in lods. Each level is simplified from the full mesh, so errors do not compound.
+inline void BuildMeshLods(const vector<Vertex> &vertices, vector<unsigned int> &indices, vector<MeshLod> &lods)
+{
+    lods.assign(1, MeshLod{0, (unsigned int)indices.size(), 0.0f});
+    float extent = MeshExtent(vertices.data(), vertices.size());
+    vector<unsigned int> full = indices;
+    size_t previous = full.size();
+    float targetError = MESH_LOD_BASE_ERROR;
+    for (unsigned int level = 1; level < MESH_LOD_MAX_LEVELS; level++, targetError *= 2.0f)
+    {
+        size_t target = (size_t)(previous * MESH_LOD_REDUCTION) / 3 * 3;
+        float error = 0.0f;
+        vector<unsigned int> reduced = SimplifyMesh(vertices, full, target, targetError, &error);
+        // stop once the error bound or the locked borders and seams keep the mesh from getting meaningfully smaller
+        if (reduced.empty() || reduced.size() > previous * MESH_LOD_MIN_SAVING)
+            break;
+        OptimizeVertexCache(reduced, vertices.size());
+        lods.push_back(MeshLod{(unsigned int)indices.size(), (unsigned int)reduced.size(), std::max(error * extent, lods.back().error)});
+        indices.insert(indices.end(), reduced.begin(), reduced.end());
+        previous = reduced.size();
+    }
+}
+#endif
@@ -10,70 +10,462 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include <learnopengl/import_profile.h>
 #include <learnopengl/mesh.h>
+#include <learnopengl/mesh_cache.h>
+#include <learnopengl/mesh_optimizer.h>
+#include <learnopengl/mesh_simplifier.h>
+#include <learnopengl/obj_loader.h>
+#include <learnopengl/render_queue.h>
 #include <learnopengl/shader.h>
-
+#include <learnopengl/texture_loader.h>
+#include <learnopengl/texture_registry.h>
+#include <learnopengl/texture_residency.h>
+#include <learnopengl/thread_pool.h>
+#include <learnopengl/trace.h>
+#include <learnopengl/vfs_assimp.h>
+
+#include <chrono>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <map>
+#include <unordered_set>
+#include <memory>
+#include <thread>
 #include <vector>
 using namespace std;
 
-unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false);
+unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false, TextureUsage usage = TextureUsage::Color);
 
+// result of the CPU-only import stage of a model. Produced by Model::Import on any thread and turned into
+// GL objects by the Model constructor on the context thread.
+struct ModelData {
+    string path;
+    string directory;
+    string profile;                      // name of the ImportProfile the meshes were processed with
+    bool loaded = false;
+    bool fromCache = false;
+    float importMilliseconds = 0.0f;     // Assimp import + processing, or cache mapping on a warm start
+    float coldLoadMilliseconds = 0.0f;   // import time recorded in the cache file (warm starts only)
+    vector<MeshData> meshes;             // cold start: processed meshes
+    VertexCacheStatistics cacheBefore;   // cold start: vertex cache behaviour of the imported index buffers
+    VertexCacheStatistics cacheAfter;    // ... and after the import-stage optimizations
+    unique_ptr<MeshCacheFile> cache;     // warm start: mapped cache file, uploaded without copying
+};
 
+// a model file and the name of the ImportProfile to process it with.
+struct ModelSource {
+    string path;
+    string profile;
+
+    ModelSource(const char *path, const string &profile = DEFAULT_IMPORT_PROFILE) : path(path), profile(profile) {}
+    ModelSource(const string &path, const string &profile = DEFAULT_IMPORT_PROFILE) : path(path), profile(profile) {}
+};
 
 class Model
 {
 public:
     // model data
-    vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
+    vector<Texture> textures_loaded;	// distinct textures used by this model; they are shared with other models through the TextureRegistry.
     vector<Mesh>    meshes;
+    string path;
     string directory;
     bool gammaCorrection;
+    VertexLayout vertexLayout;
+    GeometryRetention geometryRetention; // Keep for consumers that read Mesh::vertices/indices back
+    string importProfile;                // ImportProfile the meshes were processed with, reused on reimport
 
     // constructor, expects a filepath to a 3D model.
-    Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
+    Model(string const &path, bool gamma = false, VertexLayout layout = VertexLayout::Quantized,
+          GeometryRetention retention = GeometryRetention::Release)
+        : Model(Import(path), gamma, layout, retention)
     {
-        loadModel(path);
     }
 
-    // draws the model, and thus all its meshes
-    void Draw(Shader &shader)
+    // constructor that uploads an already imported model; must run on the thread owning the GL context.
+    // The geometry is moved out of data into the meshes.
+    Model(ModelData data, bool gamma = false, VertexLayout layout = VertexLayout::Quantized,
+          GeometryRetention retention = GeometryRetention::Release)
+        : gammaCorrection(gamma), vertexLayout(layout), geometryRetention(retention)
     {
-        for(unsigned int i = 0; i < meshes.size(); i++)
-            meshes[i].Draw(shader);
+        upload(data);
+    }
+
+    // an empty model that draws nothing until Replace() hands it its meshes.
+    static unique_ptr<Model> Empty(string const &path, bool gamma = false, VertexLayout layout = VertexLayout::Quantized,
+                                   GeometryRetention retention = GeometryRetention::Release)
+    {
+        ModelData data;
+        data.path = path;
+        data.directory = path.substr(0, path.find_last_of('/'));
+        return unique_ptr<Model>(new Model(std::move(data), gamma, layout, retention));
+    }
+
+    // textures are reference counted in the registry, so a model owns its references and is not copyable.
+    Model(const Model &) = delete;
+    Model &operator=(const Model &) = delete;
+
+    ~Model()
+    {
+        for (Mesh &mesh : meshes)
+            mesh.Release();
+        for (unsigned int id : textureReferences)
+            TextureRegistry::Instance().Release(id);
+    }
+
+    // swaps in a freshly imported version of this model (see hot_reload.h) and releases the old meshes and
+    // texture references. A failed import leaves the model untouched. Must run on the context thread.
+    bool Replace(ModelData data)
+    {
+        if (!data.loaded)
+            return false;
+        Model fresh(std::move(data), gammaCorrection, vertexLayout, geometryRetention);
+        meshes.swap(fresh.meshes);
+        textures_loaded.swap(fresh.textures_loaded);
+        textureReferences.swap(fresh.textureReferences);
+        distinctTextures.swap(fresh.distinctTextures);
+        return true;
     }
 
-    void SetShaderTextureNamePrefix(std::string prefix) {
-        for (Mesh& mesh: meshes) {
-            mesh.glslIdentifierPrefix = prefix;
+    // imports a model (OBJ or any other format ASSIMP supports) into CPU memory. Touches no GL state, so it is safe
+    // to call from worker threads. The profile picks the processing steps (see import_profile.h). Processed meshes
+    // are kept in a binary cache (see mesh_cache.h), so subsequent launches map that file instead of parsing the
+    // model again; cacheMode says whether the cache is read and written (see MeshCacheMode).
+    static ModelData Import(string const &path, const ImportProfile &profile = FindImportProfile(DEFAULT_IMPORT_PROFILE),
+                            MeshCacheMode cacheMode = MeshCacheMode::ReadWrite)
+    {
+        TraceScope trace("Model::Import", path);
+        typedef chrono::steady_clock clock;
+        ModelData data;
+        data.path = path;
+        data.profile = profile.name;
+        // retrieve the directory path of the filepath
+        data.directory = path.substr(0, path.find_last_of('/'));
+
+        // warm start: map the cache file
+        clock::time_point start = clock::now();
+        data.cache.reset(new MeshCacheFile());
+        bool cached;
+        {
+            TraceScope traceCache("map mesh cache", path);
+            cached = cacheMode == MeshCacheMode::ReadWrite && data.cache->open(path, profile.assimpFlags, profile.CacheVariant());
+        }
+        if (cached)
+        {
+            data.loaded = true;
+            data.fromCache = true;
+            data.coldLoadMilliseconds = data.cache->header().coldLoadMilliseconds;
+            data.importMilliseconds = chrono::duration<float, milli>(clock::now() - start).count();
+            return data;
+        }
+        data.cache.reset();
+
+        vector<string> dependencies;
+        if (!ImportMeshes(path, data.meshes, profile, &dependencies))
+            return data;
+        for (const MeshData &mesh : data.meshes)
+            data.cacheBefore += AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+        if (profile.flatten)
+        {
+            TraceScope traceFlatten("MergeMeshesByMaterial");
+            MergeMeshesByMaterial(data.meshes);
         }
+        // split meshes too large for 16-bit indices, reorder for vertex cache, overdraw and vertex fetch before
+        // anything is cached or uploaded, then append the reduced levels of detail to each index buffer
+        vector<MeshData> processed;
+        for (MeshData &mesh : data.meshes)
+        {
+            TraceScope traceMesh("process mesh");
+            if (profile.weld)
+                WeldVertices(mesh.vertices, mesh.indices);
+            for (MeshPart &part : SplitMesh(mesh.vertices, mesh.indices))
+            {
+                MeshData split;
+                split.vertices = std::move(part.vertices);
+                split.indices = std::move(part.indices);
+                split.textures = mesh.textures;
+                split.material = mesh.material;
+                if (profile.optimize)
+                {
+                    TraceScope traceOptimize("OptimizeMesh");
+                    OptimizeMesh(split.vertices, split.indices, nullptr, &data.cacheAfter);
+                }
+                else
+                    data.cacheAfter += AnalyzeVertexCache(split.indices, split.vertices.size());
+                if (profile.buildLods)
+                {
+                    TraceScope traceLods("BuildMeshLods");
+                    BuildMeshLods(split.vertices, split.indices, split.lods);
+                }
+                processed.push_back(std::move(split));
+            }
+        }
+        data.meshes.swap(processed);
+        data.loaded = true;
+        data.importMilliseconds = chrono::duration<float, milli>(clock::now() - start).count();
+        if (cacheMode != MeshCacheMode::Bypass)
+        {
+            TraceScope traceWrite("WriteMeshCache", path);
+            WriteMeshCache(path, profile.assimpFlags, data.meshes, data.importMilliseconds, profile.CacheVariant(), dependencies);
+        }
+        return data;
     }
-private:
-    // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
-    void loadModel(string const &path)
+
+    // reads the meshes of a model file: OBJ files through the native loader in obj_loader.h when the profile
+    // allows it, everything else (and OBJ files it can not handle) through Assimp. The other files read (material
+    // libraries) are added to dependencies when given, for the mesh cache to check.
+    static bool ImportMeshes(string const &path, vector<MeshData> &meshes,
+                             const ImportProfile &profile = FindImportProfile(DEFAULT_IMPORT_PROFILE), vector<string> *dependencies = nullptr)
     {
-        // read file via ASSIMP
+        size_t dot = path.find_last_of('.');
+        string extension = dot == string::npos ? string() : path.substr(dot);
+        if (profile.nativeObj && (extension == ".obj" || extension == ".OBJ") && LoadObj(path, meshes, dependencies))
+            return true;
+        meshes.clear();
+        if (dependencies)
+            dependencies->clear();
+        return ImportWithAssimp(path, meshes, profile.assimpFlags, dependencies);
+    }
+
+    static bool ImportWithAssimp(string const &path, vector<MeshData> &meshes, unsigned int flags = MODEL_IMPORT_FLAGS,
+                                 vector<string> *dependencies = nullptr)
+    {
+        TraceScope trace("Model::ImportWithAssimp", path);
+        // read file via ASSIMP, through the VirtualFileSystem
         Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+        vector<string> opened;
+        importer.SetIOHandler(new VfsIOSystem(&opened));
+        const aiScene* scene = importer.ReadFile(path, flags);
         // check for errors
         if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
         {
             cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
-            return;
+            return false;
         }
-        // retrieve the directory path of the filepath
-        directory = path.substr(0, path.find_last_of('/'));
+
+        if (dependencies)
+            for (const string &file : opened)
+                if (file != path)
+                    dependencies->push_back(file);
 
         // process ASSIMP's root node recursively
-        processNode(scene->mRootNode, scene);
+        processNode(scene->mRootNode, scene, meshes);
+        return true;
+    }
+
+    // imports all given models concurrently on the loader pool and uploads them on the calling (context) thread.
+    // each model is uploaded as soon as its own import has finished. See ModelStreamer for loading without blocking.
+    static vector<unique_ptr<Model>> LoadAll(const vector<ModelSource> &sources, bool gamma = false, VertexLayout layout = VertexLayout::Quantized,
+                                             GeometryRetention retention = GeometryRetention::Release);
+
+    // draws the model, and thus all its meshes
+    void Draw(Shader &shader)
+    {
+        for(unsigned int i = 0; i < meshes.size(); i++)
+            meshes[i].Draw(shader);
+    }
+
+    // draws every mesh at the level of detail its projected size calls for; model is the matrix the
+    // shader transforms with. Depth-only passes draw the position-only streams, other passes also tell the
+    // TextureResidency which mip levels of the mesh textures are visible.
+    void Draw(Shader &shader, const glm::mat4 &model, const LodSelection &selection, bool depthOnly = false)
+    {
+        for(unsigned int i = 0; i < meshes.size(); i++)
+        {
+            if (depthOnly)
+            {
+                meshes[i].DrawDepth(shader, meshes[i].SelectLod(model, selection));
+                continue;
+            }
+            float texCoordsPerPixel = meshes[i].TexCoordsPerPixel(model, selection);
+            for (const Texture &texture : meshes[i].textures)
+                TextureResidency::Instance().Request(texture.id, texCoordsPerPixel);
+            meshes[i].Draw(shader, meshes[i].SelectLod(model, selection));
+        }
+    }
+
+    // like Draw, but adds the meshes to a render queue, which draws them sorted by state and distance. The
+    // model must stay alive until the queue is submitted.
+    void Enqueue(RenderQueue &queue, const Shader &shader, const glm::mat4 &model, const LodSelection &selection, bool depthOnly = false) const
+    {
+        unsigned int transform = queue.AddTransform(model);
+        for (const Mesh &mesh : meshes)
+        {
+            if (!depthOnly)
+            {
+                float texCoordsPerPixel = mesh.TexCoordsPerPixel(model, selection);
+                for (const Texture &texture : mesh.textures)
+                    TextureResidency::Instance().Request(texture.id, texCoordsPerPixel);
+            }
+            float depth = glm::length(glm::vec3(model * glm::vec4(mesh.boundsCenter, 1.0f)) - selection.viewPosition);
+            queue.Add(shader, mesh, transform, mesh.SelectLod(model, selection), depth, depthOnly);
+        }
+    }
+
+    // prints the GPU memory of this model's textures next to what uncompressed RGBA8 with a runtime
+    // mip chain would take. Sampling bandwidth scales with the bits fetched per texel.
+    void ReportTextureMemory() const
+    {
+        size_t gpuBytes = 0, uncompressedBytes = 0;
+        double texelBits = 0.0, uncompressedTexelBits = 0.0;
+        for (const Texture &texture : textures_loaded)
+        {
+            const TextureMemoryStats *stats = TextureLoader::Instance().Stats(texture.id);
+            if (!stats)
+                continue;
+            gpuBytes += stats->gpuBytes;
+            uncompressedBytes += stats->uncompressedBytes;
+            // weight by texel count, so large textures dominate like they do when sampling
+            double texels = stats->uncompressedBytes / (stats->uncompressedBitsPerTexel / 8.0);
+            texelBits += stats->bitsPerTexel * texels;
+            uncompressedTexelBits += stats->uncompressedBitsPerTexel * texels;
+            cout << "TEXTURE::MEMORY::   " << texture.path << " " << stats->format << " "
+                 << stats->gpuBytes / 1024.0 / 1024.0 << " MB (uncompressed " << stats->uncompressedBytes / 1024.0 / 1024.0 << " MB)" << endl;
+        }
+        if (uncompressedBytes == 0)
+            return;
+        cout << "TEXTURE::MEMORY:: " << directory << ": VRAM " << gpuBytes / 1024.0 / 1024.0 << " MB instead of "
+             << uncompressedBytes / 1024.0 / 1024.0 << " MB (" << (double)uncompressedBytes / gpuBytes << "x smaller), sampling "
+             << texelBits / uncompressedTexelBits * 100.0 << "% of the uncompressed bandwidth" << endl;
+    }
+
+    // prints the CPU and GPU memory this model holds. Textures are shared through the TextureRegistry, so their
+    // GPU memory is listed separately and may be counted by several models.
+    void ReportMemory() const
+    {
+        size_t cpuBytes = sizeof(Model) + meshes.capacity() * sizeof(Mesh) + textures_loaded.capacity() * sizeof(Texture)
+                          + textureReferences.capacity() * sizeof(unsigned int) + distinctTextures.size() * sizeof(unsigned int);
+        size_t geometryBytes = 0, bufferBytes = 0, textureBytes = 0;
+        for (const Mesh &mesh : meshes)
+        {
+            cpuBytes += mesh.CpuBytes() - sizeof(Mesh);
+            geometryBytes += mesh.vertices.capacity() * sizeof(Vertex) + mesh.indices.capacity() * sizeof(unsigned int);
+            bufferBytes += mesh.GpuBytes();
+        }
+        for (const Texture &texture : textures_loaded)
+        {
+            cpuBytes += texture.type.capacity() + texture.path.capacity();
+            if (const TextureMemoryStats *stats = TextureLoader::Instance().Stats(texture.id))
+                textureBytes += stats->gpuBytes;
+        }
+        cout << "MODEL::MEMORY:: " << path << ": CPU " << cpuBytes / 1024.0 << " KB ("
+             << (geometryRetention == GeometryRetention::Keep ? "geometry kept, " : "geometry released, ") << geometryBytes / 1024.0
+             << " KB of it), GPU " << (bufferBytes + textureBytes) / 1024.0 / 1024.0 << " MB (buffers " << bufferBytes / 1024.0 / 1024.0
+             << " MB, textures " << textureBytes / 1024.0 / 1024.0 << " MB)" << endl;
+    }
+
+private:
+    // creates the GL objects of an imported model. Reported timings cover geometry only, texture loading is excluded.
+    void upload(ModelData &data)
+    {
+        TraceScope trace("Model::upload", data.path);
+        typedef chrono::steady_clock clock;
+        path = data.path;
+        directory = data.directory;
+        importProfile = data.profile;
+        if (!data.loaded)
+            return;
+
+        clock::time_point uploadStart;
+        if (data.fromCache)
+        {
+            MeshCacheFile &cache = *data.cache;
+            vector<vector<Texture>> textures;
+            for (unsigned int i = 0; i < cache.meshCount(); i++)
+                textures.push_back(loadTextures(cache.textures(i)));
+            uploadStart = clock::now();
+            for (unsigned int i = 0; i < cache.meshCount(); i++)
+            {
+                const MeshCacheRecord &record = cache.record(i);
+                meshes.push_back(Mesh(cache.vertices(i), record.vertexCount, cache.indices(i), record.indexCount, std::move(textures[i]),
+                                      cache.material(i), cache.lods(i), vertexLayout, geometryRetention));
+            }
+        }
+        else
+        {
+            for (MeshData &mesh : data.meshes)
+                mesh.textures = loadTextures(mesh.textures);
+            uploadStart = clock::now();
+            for (MeshData &mesh : data.meshes)
+                meshes.push_back(Mesh(std::move(mesh.vertices), std::move(mesh.indices), std::move(mesh.textures), mesh.material,
+                                      std::move(mesh.lods), vertexLayout, geometryRetention));
+            data.meshes.clear();
+        }
+        float uploadMs = chrono::duration<float, milli>(clock::now() - uploadStart).count();
+        if (data.fromCache)
+            cout << "MODEL::LOAD:: " << data.path << " warm: map " << data.importMilliseconds << " ms, upload " << uploadMs
+                 << " ms (cold import was " << data.coldLoadMilliseconds << " ms)" << endl;
+        else
+        {
+            cout << "MODEL::LOAD:: " << data.path << " cold: import " << data.importMilliseconds << " ms, upload " << uploadMs << " ms" << endl;
+            cout << "MODEL::OPTIMIZE:: " << data.path << " ACMR " << data.cacheBefore.ACMR() << " -> " << data.cacheAfter.ACMR()
+                 << ", ATVR " << data.cacheBefore.ATVR() << " -> " << data.cacheAfter.ATVR() << endl;
+        }
+        // triangles per level, summed over meshes; meshes with fewer levels count their coarsest one
+        vector<size_t> lodTriangles;
+        for (const Mesh &mesh : meshes)
+            for (unsigned int level = 0; level < MESH_LOD_MAX_LEVELS; level++)
+            {
+                if (lodTriangles.size() <= level)
+                    lodTriangles.push_back(0);
+                lodTriangles[level] += mesh.lods[std::min(level, (unsigned int)mesh.lods.size() - 1)].indexCount / 3;
+            }
+        size_t vertexCount = 0, indexCount = 0;
+        unsigned int transparentMeshes = 0;
+        for (const Mesh &mesh : meshes)
+        {
+            vertexCount += mesh.vertexBytes / VertexFormat::Get(mesh.layout).stride;
+            indexCount += mesh.lods[0].indexCount;
+            if (mesh.material.Transparent())
+                transparentMeshes++;
+        }
+        cout << "MODEL::IMPORT:: " << data.path << " [" << data.profile << "]: " << meshes.size() << " meshes (draw calls), "
+             << transparentMeshes << " transparent, " << vertexCount << " vertices, " << indexCount << " indices" << endl;
+        cout << "MODEL::LOD:: " << data.path << " triangles";
+        for (size_t triangles : lodTriangles)
+            cout << " " << triangles;
+        cout << endl;
+        reportVertexMemory(data.path);
+    }
+
+    // prints the vertex buffer memory (and with it the vertex fetch bandwidth) against the float layout, and for
+    // the quantized layout its largest error and how many meshes kept the float layout for exceeding the
+    // tolerances of vertex_format.h.
+    void reportVertexMemory(const string &path) const
+    {
+        size_t vertexCount = 0, vertexBytes = 0, floatBytes = 0, positionBytes = 0, indexBytes = 0, wideIndexBytes = 0;
+        unsigned int floatMeshes = 0;
+        QuantizationError error;
+        for (const Mesh &mesh : meshes)
+        {
+            size_t count = mesh.vertexBytes / VertexFormat::Get(mesh.layout).stride;
+            vertexCount += count;
+            vertexBytes += mesh.vertexBytes;
+            positionBytes += mesh.positionBytes;
+            indexBytes += mesh.indexBytes;
+            wideIndexBytes += mesh.indexCount * sizeof(unsigned int);
+            floatBytes += count * sizeof(Vertex);
+            error.merge(mesh.quantizationError);
+            if (mesh.layout != vertexLayout)
+                floatMeshes++;
+        }
+        // per vertex averages, as meshes falling back to the float layout mix strides
+        cout << "MODEL::VERTEX:: " << path << " " << (vertexCount ? (double)vertexBytes / vertexCount : 0.0) << " B/vertex, "
+             << vertexBytes / 1024.0 / 1024.0 << " MB";
+        if (vertexLayout == VertexLayout::Quantized)
+            cout << " instead of " << floatBytes / 1024.0 / 1024.0 << " MB (" << (floatBytes ? 100.0 * vertexBytes / floatBytes : 0.0)
+                 << "% of the float vertex fetch), max error: position " << error.position << " of extent, normal "
+                 << error.normalDegrees << " deg, uv " << error.texCoords << ", " << floatMeshes << " of " << meshes.size()
+                 << " meshes kept float for exceeding the tolerances";
+        cout << "; depth stream " << (vertexCount ? (double)positionBytes / vertexCount : 0.0) << " B/vertex, "
+             << positionBytes / 1024.0 / 1024.0 << " MB"
+             << "; indices " << indexBytes / 1024.0 / 1024.0 << " MB instead of " << wideIndexBytes / 1024.0 / 1024.0 << " MB" << endl;
     }
 
     // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-    void processNode(aiNode *node, const aiScene *scene)
+    static void processNode(aiNode *node, const aiScene *scene, vector<MeshData> &meshData)
     {
         // process each mesh located at the current node
         for(unsigned int i = 0; i < node->mNumMeshes; i++)
@@ -81,22 +473,23 @@ private:
             // the node object only contains indices to index the actual objects in the scene.
             // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
             aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            meshData.push_back(processMesh(mesh, scene));
         }
         // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
         for(unsigned int i = 0; i < node->mNumChildren; i++)
         {
-            processNode(node->mChildren[i], scene);
+            processNode(node->mChildren[i], scene, meshData);
         }
 
     }
 
-    Mesh processMesh(aiMesh *mesh, const aiScene *scene)
+    static MeshData processMesh(aiMesh *mesh, const aiScene *scene)
     {
         // data to fill
-        vector<Vertex> vertices;
-        vector<unsigned int> indices;
-        vector<Texture> textures;
+        MeshData data;
+        vector<Vertex> &vertices = data.vertices;
+        vector<unsigned int> &indices = data.indices;
+        vector<Texture> &textures = data.textures;
 
         // walk through each of the mesh's vertices
         for(unsigned int i = 0; i < mesh->mNumVertices; i++)
@@ -159,8 +552,12 @@ private:
         // diffuse: texture_diffuseN
         // specular: texture_specularN
         // normal: texture_normalN
-        aiColor3D color(0.0f, 0.0f, 0.0f);
-        material->Get(AI_MATKEY_COLOR_AMBIENT, color);
+        // shininess and opacity go to the MaterialBlock; an exponent of 0 means the file has none
+        float shininess = 0.0f, opacity = 1.0f;
+        if (material->Get(AI_MATKEY_SHININESS, shininess) == aiReturn_SUCCESS && shininess > 0.0f)
+            data.material.shininess = shininess;
+        if (material->Get(AI_MATKEY_OPACITY, opacity) == aiReturn_SUCCESS)
+            data.material.opacity = opacity;
 
 
         // 1. diffuse maps
@@ -178,82 +575,129 @@ private:
 
 
 
-        // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        // return the extracted mesh data; textures are only referenced here and loaded when the mesh is created
+        return data;
     }
 
-    // checks all material textures of a given type and loads the textures if they're not loaded yet.
-    // the required info is returned as a Texture struct.
-    vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
+    // collects the texture references of all material textures of a given type.
+    static vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
     {
         vector<Texture> textures;
         for(unsigned int i = 0; i < mat->GetTextureCount(type); i++)
         {
             aiString str;
             mat->GetTexture(type, i, &str);
-            // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-            bool skip = false;
-            for(unsigned int j = 0; j < textures_loaded.size(); j++)
-            {
-                if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-                {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-                    break;
-                }
-            }
-            if(!skip)
-            {   // if texture hasn't been loaded already, load it
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
-            }
+            Texture texture;
+            texture.id = 0;
+            texture.type = typeName;
+            texture.path = str.C_Str();
+            textures.push_back(texture);
+        }
+        return textures;
+    }
+
+    // resolves the referenced textures through the process-wide TextureRegistry and fills in their ids.
+    vector<Texture> loadTextures(vector<Texture> textures)
+    {
+        TraceScope trace("Model::loadTextures");
+        for (Texture &texture : textures)
+        {
+            TextureUsage usage = texture.type == "texture_normal" ? TextureUsage::NormalMap : TextureUsage::Color;
+            texture.id = TextureRegistry::Instance().Acquire(directory + '/' + texture.path, gammaCorrection, usage);
+            textureReferences.push_back(texture.id);
+            if (distinctTextures.insert(texture.id).second)
+                textures_loaded.push_back(texture);
         }
         return textures;
     }
+
+    vector<unsigned int> textureReferences; // one entry per Acquire, released in the destructor
+    unordered_set<unsigned int> distinctTextures;
 };
 
 
-unsigned int TextureFromFile(const char *path, const string &directory, bool gamma)
+// Streams models into the scene: Load() hands out empty models right away and Update() swaps each one's meshes in
+// once its import on the loader pool has finished, so rendering can start before anything is loaded.
+class ModelStreamer
 {
-    string filename = string(path);
-    filename = directory + '/' + filename;
-
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
+public:
+    // starts importing the given models and returns them, still empty, in the order given.
+    vector<unique_ptr<Model>> Load(const vector<ModelSource> &sources, bool gamma = false, VertexLayout layout = VertexLayout::Quantized,
+                                   GeometryRetention retention = GeometryRetention::Release)
+    {
+        TraceScope trace("ModelStreamer::Load");
+        vector<unique_ptr<Model>> models;
+        for (const ModelSource &source : sources)
+        {
+            const ImportProfile &profile = FindImportProfile(source.profile);
+            models.push_back(Model::Empty(source.path, gamma, layout, retention));
+            models.back()->importProfile = profile.name;
+            PendingModel pending;
+            pending.model = models.back().get();
+            string path = source.path;
+            pending.import = ThreadPool::Loaders().Submit([path, &profile] { return Model::Import(path, profile); });
+            this->pending.push_back(std::move(pending));
+        }
+        return models;
+    }
 
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
+    // uploads at most maxModels models whose import has finished, so a single frame never pays for all of
+    // them. Returns the number of models uploaded. Must run on the context thread.
+    unsigned int Update(unsigned int maxModels = 1)
     {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
+        unsigned int uploaded = 0;
+        for (auto it = pending.begin(); it != pending.end() && uploaded < maxModels;)
+        {
+            if (it->import.wait_for(chrono::seconds(0)) != future_status::ready)
+            {
+                ++it;
+                continue;
+            }
+            it->model->Replace(it->import.get());
+            it = pending.erase(it);
+            uploaded++;
+        }
+        return uploaded;
     }
-    else
+
+    bool Idle() const { return pending.empty(); }
+
+private:
+    struct PendingModel {
+        Model *model;
+        future<ModelData> import;
+    };
+
+    vector<PendingModel> pending;
+};
+
+inline vector<unique_ptr<Model>> Model::LoadAll(const vector<ModelSource> &sources, bool gamma, VertexLayout layout, GeometryRetention retention)
+{
+    TraceScope trace("Model::LoadAll");
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    ModelStreamer streamer;
+    vector<unique_ptr<Model>> models = streamer.Load(sources, gamma, layout, retention);
+    while (!streamer.Idle())
     {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
+        // keep streaming finished textures of earlier models while the remaining imports are still running
+        if (streamer.Update() == 0)
+            this_thread::sleep_for(chrono::milliseconds(1));
+        TextureLoader::Instance().Update();
     }
+    cout << "MODEL::LOAD:: " << sources.size() << " models in "
+         << chrono::duration<float, milli>(chrono::steady_clock::now() - start).count() << " ms on "
+         << ThreadPool::Loaders().Size() << " loader threads" << endl;
+    return models;
+}
+
+// returns a texture name immediately; the image is decoded on the loader pool and uploaded by TextureLoader::Update.
+// the texture is shared through the TextureRegistry, release it there when it is no longer needed.
+unsigned int TextureFromFile(const char *path, const string &directory, bool gamma, TextureUsage usage)
+{
+    string filename = string(path);
+    filename = directory + '/' + filename;
+    TraceScope trace("TextureFromFile", filename);
 
-    return textureID;
+    return TextureRegistry::Instance().Acquire(filename, gamma, usage);
 }
 #endif
@@ -0,0 +1,654 @@
+#ifndef OBJ_LOADER_H
+#define OBJ_LOADER_H
+
+#include <learnopengl/mesh_cache.h>
+#include <learnopengl/thread_pool.h>
+#include <learnopengl/trace.h>
+#include <learnopengl/vfs.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+// Fast path for Wavefront OBJ/MTL files, producing the same MeshData as Assimp followed by Model::processMesh
+// with MODEL_IMPORT_FLAGS (see import_profile.h):
+//   - the file is memory mapped and split into line aligned chunks that are parsed in parallel on the loader pool
+//   - faces are grouped into meshes by object, group and material in file order, fan triangulated, and every
+//     distinct v/vt/vn corner becomes one vertex (so the result is already welded)
+//   - UVs are flipped (aiProcess_FlipUVs), missing normals are smoothed per position (aiProcess_GenSmoothNormals)
+//     and tangents are accumulated per vertex from the UV gradients (aiProcess_CalcTangentSpace)
+//   - material textures map like Assimp's: map_Kd diffuse, map_Ks specular, bump/map_bump height (our
+//     "texture_normal"), map_Ka ambient (our "texture_height"); Ns is the shininess, d (or 1 - Tr) the opacity
+// Anything the loader does not understand makes LoadObj return false, and the caller falls back to Assimp.
+
+// index of a v/vt/vn element; negative OBJ indices are resolved per chunk and rebased after merging
+const int32_t OBJ_MISSING = -1;
+const int32_t OBJ_CHUNK_RELATIVE = 0x40000000;
+const size_t OBJ_MIN_CHUNK_BYTES = 256 * 1024;
+
+struct ObjCorner {
+    int32_t v, vt, vn;
+};
+
+struct ObjCornerHash {
+    size_t operator()(const ObjCorner &c) const
+    {
+        return ((size_t)(uint32_t)c.v * 73856093u) ^ ((size_t)(uint32_t)c.vt * 19349663u) ^ ((size_t)(uint32_t)c.vn * 83492791u);
+    }
+};
+
+inline bool operator==(const ObjCorner &a, const ObjCorner &b)
+{
+    return a.v == b.v && a.vt == b.vt && a.vn == b.vn;
+}
+
+// statement that changes how the following faces are grouped
+struct ObjEvent {
+    enum Kind { Object, Group, Material, MaterialLibrary } kind;
+    size_t face; // index of the first face it applies to
+    string name;
+};
+
+struct ObjChunk {
+    vector<float> positions, texCoords, normals; // 3, 2 and 3 floats per element
+    vector<ObjCorner> corners;
+    vector<uint32_t> faceStarts;                 // first corner of every face
+    vector<ObjEvent> events;
+    string error;
+};
+
+struct ObjMaterial {
+    string diffuse, specular, bump, ambient;
+    MaterialParameters parameters;
+};
+
+inline bool objIsSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline const char *objSkipSpace(const char *p, const char *end)
+{
+    while (p < end && objIsSpace(*p))
+        p++;
+    return p;
+}
+
+// locale independent decimal parser; enough digits are kept for the result to round like strtof.
+inline bool objParseFloat(const char *&p, const char *end, float &result)
+{
+    static const double powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                    1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    p = objSkipSpace(p, end);
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+    uint64_t mantissa = 0;
+    int exponent = 0, digits = 0;
+    const char *start = p;
+    for (; p < end && *p >= '0' && *p <= '9'; p++)
+    {
+        if (digits < 19)
+        {
+            mantissa = mantissa * 10 + (*p - '0');
+            digits += mantissa != 0;
+        }
+        else
+            exponent++;
+    }
+    if (p < end && *p == '.')
+    {
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++)
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + (*p - '0');
+                digits += mantissa != 0;
+                exponent--;
+            }
+    }
+    if (p == start || (p == start + 1 && *start == '.'))
+        return false;
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        const char *q = p + 1;
+        bool negativeExponent = false;
+        if (q < end && (*q == '-' || *q == '+'))
+            negativeExponent = *q++ == '-';
+        int value = 0;
+        const char *digitsStart = q;
+        for (; q < end && *q >= '0' && *q <= '9'; q++)
+            value = std::min(value * 10 + (*q - '0'), 1000);
+        if (q > digitsStart)
+        {
+            exponent += negativeExponent ? -value : value;
+            p = q;
+        }
+    }
+    double value = (double)mantissa;
+    if (exponent < 0)
+        value = exponent >= -22 ? value / powers[-exponent] : value * pow(10.0, exponent);
+    else if (exponent > 0)
+        value = exponent <= 22 ? value * powers[exponent] : value * pow(10.0, exponent);
+    result = (float)(negative ? -value : value);
+    return true;
+}
+
+inline bool objParseInt(const char *&p, const char *end, int64_t &result)
+{
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+    const char *start = p;
+    int64_t value = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; p++)
+        value = std::min<int64_t>(value * 10 + (*p - '0'), OBJ_CHUNK_RELATIVE);
+    result = negative ? -value : value;
+    return p > start;
+}
+
+// resolves a 1-based (or negative, relative) OBJ index against the number of elements this chunk has read so far
+inline int32_t objResolveIndex(int64_t index, size_t localCount)
+{
+    if (index > 0)
+        return index < OBJ_CHUNK_RELATIVE ? (int32_t)(index - 1) : OBJ_MISSING;
+    if (index < 0 && (int64_t)localCount + index >= 0)
+        return (int32_t)(localCount + index) | OBJ_CHUNK_RELATIVE;
+    return OBJ_MISSING; // 0 is invalid, and relative indices reaching into previous chunks are not supported
+}
+
+inline string objRestOfLine(const char *p, const char *end)
+{
+    p = objSkipSpace(p, end);
+    while (end > p && objIsSpace(end[-1]))
+        end--;
+    return string(p, end);
+}
+
+inline void parseObjChunk(const char *p, const char *end, ObjChunk &chunk)
+{
+    while (p < end && chunk.error.empty())
+    {
+        const char *lineEnd = (const char *)memchr(p, '\n', end - p);
+        if (!lineEnd)
+            lineEnd = end;
+        const char *q = objSkipSpace(p, lineEnd);
+        const char *keyword = q;
+        while (q < lineEnd && !objIsSpace(*q))
+            q++;
+        size_t keywordLength = q - keyword;
+
+        if (keywordLength == 1 && keyword[0] == 'v')
+        {
+            float x = 0.0f, y = 0.0f, z = 0.0f;
+            if (!objParseFloat(q, lineEnd, x) || !objParseFloat(q, lineEnd, y) || !objParseFloat(q, lineEnd, z))
+                chunk.error = "bad vertex";
+            chunk.positions.insert(chunk.positions.end(), {x, y, z});
+        }
+        else if (keywordLength == 2 && keyword[0] == 'v' && keyword[1] == 't')
+        {
+            float u = 0.0f, v = 0.0f;
+            if (!objParseFloat(q, lineEnd, u))
+                chunk.error = "bad texture coordinate";
+            objParseFloat(q, lineEnd, v);
+            chunk.texCoords.insert(chunk.texCoords.end(), {u, v});
+        }
+        else if (keywordLength == 2 && keyword[0] == 'v' && keyword[1] == 'n')
+        {
+            float x = 0.0f, y = 0.0f, z = 0.0f;
+            if (!objParseFloat(q, lineEnd, x) || !objParseFloat(q, lineEnd, y) || !objParseFloat(q, lineEnd, z))
+                chunk.error = "bad normal";
+            chunk.normals.insert(chunk.normals.end(), {x, y, z});
+        }
+        else if (keywordLength == 1 && keyword[0] == 'f')
+        {
+            uint32_t first = (uint32_t)chunk.corners.size();
+            for (q = objSkipSpace(q, lineEnd); q < lineEnd; q = objSkipSpace(q, lineEnd))
+            {
+                ObjCorner corner = {OBJ_MISSING, OBJ_MISSING, OBJ_MISSING};
+                int64_t index;
+                if (!objParseInt(q, lineEnd, index) || (corner.v = objResolveIndex(index, chunk.positions.size() / 3)) == OBJ_MISSING)
+                {
+                    chunk.error = "bad face";
+                    break;
+                }
+                if (q < lineEnd && *q == '/')
+                {
+                    q++;
+                    if (q < lineEnd && *q != '/' && (!objParseInt(q, lineEnd, index)
+                                                     || (corner.vt = objResolveIndex(index, chunk.texCoords.size() / 2)) == OBJ_MISSING))
+                        chunk.error = "bad face";
+                    if (q < lineEnd && *q == '/')
+                    {
+                        q++;
+                        if (!objParseInt(q, lineEnd, index) || (corner.vn = objResolveIndex(index, chunk.normals.size() / 3)) == OBJ_MISSING)
+                            chunk.error = "bad face";
+                    }
+                }
+                if (q < lineEnd && !objIsSpace(*q))
+                    chunk.error = "bad face";
+                if (!chunk.error.empty())
+                    break;
+                chunk.corners.push_back(corner);
+            }
+            if (chunk.corners.size() - first < 3)
+                chunk.corners.resize(first); // a face needs three corners to be drawn as triangles
+            else
+                chunk.faceStarts.push_back(first);
+        }
+        else if (keywordLength == 1 && (keyword[0] == 'o' || keyword[0] == 'g'))
+            chunk.events.push_back({keyword[0] == 'o' ? ObjEvent::Object : ObjEvent::Group, chunk.faceStarts.size(), objRestOfLine(q, lineEnd)});
+        else if (keywordLength == 6 && memcmp(keyword, "usemtl", 6) == 0)
+            chunk.events.push_back({ObjEvent::Material, chunk.faceStarts.size(), objRestOfLine(q, lineEnd)});
+        else if (keywordLength == 6 && memcmp(keyword, "mtllib", 6) == 0)
+            chunk.events.push_back({ObjEvent::MaterialLibrary, chunk.faceStarts.size(), objRestOfLine(q, lineEnd)});
+        else if (keywordLength == 1 && (keyword[0] == 'l' || keyword[0] == 'p'))
+            ; // lines and points are not drawn
+        else if (keywordLength > 0 && keyword[0] != '#' && !(keywordLength == 1 && keyword[0] == 's'))
+            chunk.error = "unsupported statement " + string(keyword, keywordLength); // curves, surfaces, ...
+        p = lineEnd + 1;
+    }
+}
+
+// the texture file of a map_* statement: the last token once the options (-bm 0.5, -o u v w, ...) are skipped.
+inline string objTexturePath(const string &arguments)
+{
+    static const map<string, int> optionArguments = {{"-blendu", 1}, {"-blendv", 1}, {"-boost", 1}, {"-mm", 2}, {"-o", 3},
+                                                     {"-s", 3}, {"-t", 3}, {"-texres", 1}, {"-clamp", 1}, {"-bm", 1},
+                                                     {"-imfchan", 1}, {"-type", 1}, {"-cc", 1}};
+    istringstream stream(arguments);
+    string token, path;
+    while (stream >> token)
+    {
+        auto option = optionArguments.find(token);
+        if (option != optionArguments.end())
+        {
+            // -o, -s and -t take one to three numbers
+            for (int i = 0; i < option->second; i++)
+            {
+                streampos position = stream.tellg();
+                string argument;
+                if (!(stream >> argument))
+                    break;
+                if (i > 0 && option->second == 3 && !(isdigit((unsigned char)argument[0]) || argument[0] == '-' || argument[0] == '.'))
+                {
+                    stream.seekg(position);
+                    break;
+                }
+            }
+            continue;
+        }
+        // the remainder is the file name, which may contain spaces
+        string rest;
+        getline(stream, rest);
+        path = token + rest;
+        break;
+    }
+    while (!path.empty() && objIsSpace(path.back()))
+        path.pop_back();
+    return path;
+}
+
+inline void loadObjMaterials(const string &path, map<string, ObjMaterial> &materials)
+{
+    string contents;
+    if (!VirtualFileSystem::Instance().Read(path, contents))
+    {
+        cout << "ERROR::OBJ:: could not read material library " << path << endl;
+        return;
+    }
+    istringstream file(contents);
+    ObjMaterial *material = nullptr;
+    string line;
+    while (getline(file, line))
+    {
+        const char *p = objSkipSpace(line.data(), line.data() + line.size());
+        const char *end = line.data() + line.size();
+        const char *keywordEnd = p;
+        while (keywordEnd < end && !objIsSpace(*keywordEnd))
+            keywordEnd++;
+        string keyword(p, keywordEnd);
+        string arguments = objRestOfLine(keywordEnd, end);
+        if (keyword == "newmtl")
+            material = &materials[arguments];
+        else if (!material)
+            continue;
+        else if (keyword == "map_Kd")
+            material->diffuse = objTexturePath(arguments);
+        else if (keyword == "map_Ks")
+            material->specular = objTexturePath(arguments);
+        else if (keyword == "map_bump" || keyword == "map_Bump" || keyword == "bump")
+            material->bump = objTexturePath(arguments);
+        else if (keyword == "map_Ka")
+            material->ambient = objTexturePath(arguments);
+        else if (keyword == "Ns" || keyword == "d" || keyword == "Tr")
+        {
+            const char *q = arguments.data();
+            float value;
+            if (!objParseFloat(q, arguments.data() + arguments.size(), value))
+                continue;
+            if (keyword == "Ns")
+            {
+                if (value > 0.0f) // as for Assimp, an exponent of 0 means the file has none
+                    material->parameters.shininess = value;
+            }
+            else
+                material->parameters.opacity = keyword == "d" ? value : 1.0f - value;
+        }
+    }
+}
+
+// a run of faces that becomes one mesh
+struct ObjSegment {
+    size_t firstFace, endFace;
+    string material;
+};
+
+inline MeshData buildObjMesh(const ObjChunk &obj, const ObjSegment &segment, const map<string, ObjMaterial> &materials)
+{
+    MeshData mesh;
+    unordered_map<ObjCorner, unsigned int, ObjCornerHash> vertexIds;
+    vector<int32_t> vertexPositions; // OBJ position index of every vertex
+    vector<bool> vertexHasNormal;
+    bool missingNormals = false;
+    for (size_t face = segment.firstFace; face < segment.endFace; face++)
+    {
+        uint32_t begin = obj.faceStarts[face];
+        uint32_t end = face + 1 < obj.faceStarts.size() ? obj.faceStarts[face + 1] : (uint32_t)obj.corners.size();
+        unsigned int ids[3];
+        for (uint32_t c = begin; c < end; c++)
+        {
+            const ObjCorner &corner = obj.corners[c];
+            auto inserted = vertexIds.emplace(corner, (unsigned int)mesh.vertices.size());
+            if (inserted.second)
+            {
+                Vertex vertex;
+                vertex.Normal = glm::vec3(0.0f);
+                vertex.TexCoords = glm::vec2(0.0f, 0.0f);
+                vertex.Position = glm::vec3(obj.positions[corner.v * 3], obj.positions[corner.v * 3 + 1], obj.positions[corner.v * 3 + 2]);
+                if (corner.vn != OBJ_MISSING)
+                    vertex.Normal = glm::vec3(obj.normals[corner.vn * 3], obj.normals[corner.vn * 3 + 1], obj.normals[corner.vn * 3 + 2]);
+                else
+                    missingNormals = true;
+                if (corner.vt != OBJ_MISSING)
+                    vertex.TexCoords = glm::vec2(obj.texCoords[corner.vt * 2], 1.0f - obj.texCoords[corner.vt * 2 + 1]);
+                mesh.vertices.push_back(vertex);
+                vertexPositions.push_back(corner.v);
+                vertexHasNormal.push_back(corner.vn != OBJ_MISSING);
+            }
+            // fan triangulation
+            unsigned int id = inserted.first->second;
+            if (c - begin < 2)
+                ids[c - begin] = id;
+            else
+            {
+                mesh.indices.insert(mesh.indices.end(), {ids[0], ids[1], id});
+                ids[1] = id;
+            }
+        }
+    }
+
+    // smooth normals for corners without one: area weighted face normals summed per position
+    if (missingNormals)
+    {
+        unordered_map<int32_t, glm::vec3> smooth;
+        for (size_t t = 0; t + 2 < mesh.indices.size(); t += 3)
+        {
+            const glm::vec3 &a = mesh.vertices[mesh.indices[t]].Position;
+            glm::vec3 faceNormal = glm::cross(mesh.vertices[mesh.indices[t + 1]].Position - a, mesh.vertices[mesh.indices[t + 2]].Position - a);
+            for (int k = 0; k < 3; k++)
+            {
+                auto inserted = smooth.emplace(vertexPositions[mesh.indices[t + k]], faceNormal);
+                if (!inserted.second)
+                    inserted.first->second += faceNormal;
+            }
+        }
+        for (size_t i = 0; i < mesh.vertices.size(); i++)
+        {
+            if (vertexHasNormal[i])
+                continue;
+            glm::vec3 normal = smooth[vertexPositions[i]];
+            float length = glm::length(normal);
+            mesh.vertices[i].Normal = length > 0.0f ? normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+        }
+    }
+
+    // tangent frame from the UV gradients of every triangle, accumulated per vertex and orthogonalized
+    vector<glm::vec3> tangents(mesh.vertices.size(), glm::vec3(0.0f)), bitangents(mesh.vertices.size(), glm::vec3(0.0f));
+    for (size_t t = 0; t + 2 < mesh.indices.size(); t += 3)
+    {
+        const Vertex &a = mesh.vertices[mesh.indices[t]], &b = mesh.vertices[mesh.indices[t + 1]], &c = mesh.vertices[mesh.indices[t + 2]];
+        glm::vec3 v = b.Position - a.Position, w = c.Position - a.Position;
+        float sx = b.TexCoords.x - a.TexCoords.x, sy = b.TexCoords.y - a.TexCoords.y;
+        float tx = c.TexCoords.x - a.TexCoords.x, ty = c.TexCoords.y - a.TexCoords.y;
+        float direction = (tx * sy - ty * sx) < 0.0f ? -1.0f : 1.0f;
+        if (sx * ty == sy * tx)
+        {
+            sx = 0.0f; sy = 1.0f;
+            tx = 1.0f; ty = 0.0f;
+        }
+        glm::vec3 tangent = (w * sy - v * ty) * direction;
+        glm::vec3 bitangent = (w * sx - v * tx) * direction;
+        for (int k = 0; k < 3; k++)
+        {
+            tangents[mesh.indices[t + k]] += tangent;
+            bitangents[mesh.indices[t + k]] += bitangent;
+        }
+    }
+    for (size_t i = 0; i < mesh.vertices.size(); i++)
+    {
+        Vertex &vertex = mesh.vertices[i];
+        glm::vec3 tangent = tangents[i] - vertex.Normal * glm::dot(tangents[i], vertex.Normal);
+        glm::vec3 bitangent = bitangents[i] - vertex.Normal * glm::dot(bitangents[i], vertex.Normal);
+        float tangentLength = glm::length(tangent), bitangentLength = glm::length(bitangent);
+        vertex.Tangent = tangentLength > 0.0f ? tangent / tangentLength : glm::vec3(0.0f);
+        vertex.Bitangent = bitangentLength > 0.0f ? bitangent / bitangentLength : glm::vec3(0.0f);
+    }
+
+    // textures in the order Model::processMesh lists them
+    auto material = materials.find(segment.material);
+    if (material != materials.end())
+    {
+        mesh.material = material->second.parameters;
+        const pair<const string *, const char *> maps[] = {{&material->second.diffuse, "texture_diffuse"},
+                                                          {&material->second.specular, "texture_specular"},
+                                                          {&material->second.bump, "texture_normal"},
+                                                          {&material->second.ambient, "texture_height"}};
+        for (const auto &entry : maps)
+            if (!entry.first->empty())
+            {
+                Texture texture;
+                texture.id = 0;
+                texture.type = entry.second;
+                texture.path = *entry.first;
+                mesh.textures.push_back(texture);
+            }
+    }
+    return mesh;
+}
+
+// checks that two imports of the same file describe the same meshes: equal textures and triangle counts, the same
+// set of distinct vertices (position, normal, UV) and the same surface area. Triangulation of polygons and tangents
+// may differ. Returns a description of the first difference, or an empty string.
+inline string CompareMeshData(const vector<MeshData> &a, const vector<MeshData> &b, float tolerance = 1e-4f)
+{
+    if (a.size() != b.size())
+        return to_string(a.size()) + " meshes instead of " + to_string(b.size());
+    struct Key {
+        float values[8];
+        bool operator<(const Key &o) const { return lexicographical_compare(values, values + 8, o.values, o.values + 8); }
+    };
+    auto keys = [](const MeshData &mesh) {
+        vector<Key> result;
+        for (unsigned int index : mesh.indices)
+        {
+            const Vertex &v = mesh.vertices[index];
+            result.push_back({{v.Position.x, v.Position.y, v.Position.z, v.Normal.x, v.Normal.y, v.Normal.z, v.TexCoords.x, v.TexCoords.y}});
+        }
+        sort(result.begin(), result.end());
+        result.erase(unique(result.begin(), result.end(), [](const Key &x, const Key &y) { return !(x < y) && !(y < x); }), result.end());
+        return result;
+    };
+    auto area = [](const MeshData &mesh) {
+        double sum = 0.0;
+        for (size_t t = 0; t + 2 < mesh.indices.size(); t += 3)
+        {
+            const glm::vec3 &p = mesh.vertices[mesh.indices[t]].Position;
+            sum += glm::length(glm::cross(mesh.vertices[mesh.indices[t + 1]].Position - p, mesh.vertices[mesh.indices[t + 2]].Position - p)) * 0.5;
+        }
+        return sum;
+    };
+    for (size_t m = 0; m < a.size(); m++)
+    {
+        string mesh = "mesh " + to_string(m) + ": ";
+        if (a[m].textures.size() != b[m].textures.size())
+            return mesh + "different texture count";
+        for (size_t t = 0; t < a[m].textures.size(); t++)
+            if (a[m].textures[t].type != b[m].textures[t].type || a[m].textures[t].path != b[m].textures[t].path)
+                return mesh + "texture " + a[m].textures[t].path + " instead of " + b[m].textures[t].path;
+        if (a[m].material.shininess != b[m].material.shininess || a[m].material.opacity != b[m].material.opacity)
+            return mesh + "different material parameters";
+        if (a[m].indices.size() != b[m].indices.size())
+            return mesh + to_string(a[m].indices.size() / 3) + " triangles instead of " + to_string(b[m].indices.size() / 3);
+        vector<Key> keysA = keys(a[m]), keysB = keys(b[m]);
+        if (keysA.size() != keysB.size())
+            return mesh + to_string(keysA.size()) + " distinct vertices instead of " + to_string(keysB.size());
+        for (size_t i = 0; i < keysA.size(); i++)
+            for (int c = 0; c < 8; c++)
+                if (fabsf(keysA[i].values[c] - keysB[i].values[c]) > tolerance * std::max(1.0f, fabsf(keysB[i].values[c])))
+                    return mesh + "vertex " + to_string(i) + " differs";
+        double areaA = area(a[m]), areaB = area(b[m]);
+        if (fabs(areaA - areaB) > tolerance * std::max(1.0, areaB))
+            return mesh + "surface area " + to_string(areaA) + " instead of " + to_string(areaB);
+    }
+    return string();
+}
+
+// parses an OBJ file (and its material libraries) into meshes ready for the optimization pipeline. The material
+// libraries it reads are added to dependencies when given. Returns false if the file can not be read or uses
+// features the fast path does not support.
+inline bool LoadObj(const string &path, vector<MeshData> &meshes, vector<string> *dependencies = nullptr)
+{
+    TraceScope trace("LoadObj", path);
+    VfsFile file = VirtualFileSystem::Instance().Open(path);
+    if (!file || file.size() == 0)
+        return false;
+    const char *data = file.data();
+    size_t size = file.size();
+
+    // parse line aligned chunks in parallel
+    size_t chunkCount = std::max<size_t>(1, std::min<size_t>(ThreadPool::Loaders().Size(), size / OBJ_MIN_CHUNK_BYTES));
+    vector<const char *> bounds(chunkCount + 1);
+    bounds[0] = data;
+    bounds[chunkCount] = data + size;
+    for (size_t i = 1; i < chunkCount; i++)
+    {
+        const char *p = std::max(bounds[i - 1], data + size * i / chunkCount);
+        const char *newline = (const char *)memchr(p, '\n', data + size - p);
+        bounds[i] = newline ? newline + 1 : data + size;
+    }
+    vector<ObjChunk> chunks(chunkCount);
+    ThreadPool::Loaders().ParallelFor(chunkCount, [&](size_t i) {
+        TraceScope traceChunk("parseObjChunk");
+        parseObjChunk(bounds[i], bounds[i + 1], chunks[i]);
+    });
+    file = VfsFile();
+
+    // merge into the first chunk, rebasing indices by the element counts of the chunks before
+    ObjChunk &obj = chunks[0];
+    for (size_t i = 0; i < chunkCount; i++)
+        if (!chunks[i].error.empty())
+        {
+            cout << "ERROR::OBJ:: " << path << ": " << chunks[i].error << ", falling back to Assimp" << endl;
+            return false;
+        }
+    for (size_t i = 1; i < chunkCount; i++)
+    {
+        ObjChunk &chunk = chunks[i];
+        int32_t bases[3] = {(int32_t)(obj.positions.size() / 3), (int32_t)(obj.texCoords.size() / 2), (int32_t)(obj.normals.size() / 3)};
+        size_t cornerBase = obj.corners.size(), faceBase = obj.faceStarts.size();
+        for (ObjCorner corner : chunk.corners)
+        {
+            int32_t *indices[3] = {&corner.v, &corner.vt, &corner.vn};
+            for (int k = 0; k < 3; k++)
+                if (*indices[k] != OBJ_MISSING && (*indices[k] & OBJ_CHUNK_RELATIVE))
+                    *indices[k] = (*indices[k] & ~OBJ_CHUNK_RELATIVE) + bases[k];
+            obj.corners.push_back(corner);
+        }
+        for (uint32_t start : chunk.faceStarts)
+            obj.faceStarts.push_back((uint32_t)(start + cornerBase));
+        for (ObjEvent &event : chunk.events)
+        {
+            event.face += faceBase;
+            obj.events.push_back(std::move(event));
+        }
+        obj.positions.insert(obj.positions.end(), chunk.positions.begin(), chunk.positions.end());
+        obj.texCoords.insert(obj.texCoords.end(), chunk.texCoords.begin(), chunk.texCoords.end());
+        obj.normals.insert(obj.normals.end(), chunk.normals.begin(), chunk.normals.end());
+        chunk = ObjChunk();
+    }
+    for (ObjCorner &corner : obj.corners)
+    {
+        int32_t *indices[3] = {&corner.v, &corner.vt, &corner.vn};
+        for (int k = 0; k < 3; k++)
+            if (*indices[k] != OBJ_MISSING && (*indices[k] & OBJ_CHUNK_RELATIVE))
+                *indices[k] &= ~OBJ_CHUNK_RELATIVE;
+        if ((size_t)corner.v >= obj.positions.size() / 3
+            || (corner.vt != OBJ_MISSING && (size_t)corner.vt >= obj.texCoords.size() / 2)
+            || (corner.vn != OBJ_MISSING && (size_t)corner.vn >= obj.normals.size() / 3))
+        {
+            cout << "ERROR::OBJ:: " << path << ": index out of range, falling back to Assimp" << endl;
+            return false;
+        }
+    }
+
+    // split the faces into meshes wherever the object, group or material changes
+    string directory = path.substr(0, path.find_last_of('/'));
+    map<string, ObjMaterial> materials;
+    vector<ObjSegment> segments;
+    ObjSegment current = {0, 0, string()};
+    size_t nextEvent = 0;
+    for (size_t face = 0; face <= obj.faceStarts.size(); face++)
+    {
+        for (; nextEvent < obj.events.size() && obj.events[nextEvent].face == face; nextEvent++)
+        {
+            const ObjEvent &event = obj.events[nextEvent];
+            if (event.kind == ObjEvent::MaterialLibrary)
+            {
+                TraceScope traceMaterials("loadObjMaterials", event.name);
+                string library = directory + '/' + event.name;
+                if (dependencies)
+                    dependencies->push_back(library);
+                loadObjMaterials(library, materials);
+                continue;
+            }
+            if (event.kind == ObjEvent::Material && event.name == current.material)
+                continue;
+            current.endFace = face;
+            if (current.endFace > current.firstFace)
+                segments.push_back(current);
+            current.firstFace = face;
+            if (event.kind == ObjEvent::Material)
+                current.material = event.name;
+        }
+    }
+    current.endFace = obj.faceStarts.size();
+    if (current.endFace > current.firstFace)
+        segments.push_back(current);
+
+    meshes.resize(segments.size());
+    ThreadPool::Loaders().ParallelFor(segments.size(), [&](size_t i) {
+        TraceScope traceMesh("buildObjMesh", segments[i].material);
+        meshes[i] = buildObjMesh(obj, segments[i], materials);
+    });
+    return true;
+}
+#endif
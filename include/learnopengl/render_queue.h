@@ -0,0 +1,159 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/material.h>
+#include <learnopengl/mesh.h>
+#include <learnopengl/shader.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+using namespace std;
+
+// one mesh to draw in a pass, see RenderQueue
+struct DrawItem {
+    uint64_t key;
+    const Shader *shader;
+    const Mesh *mesh;
+    unsigned int transform; // index into the queue's transforms
+    unsigned int lod;
+    bool depthOnly;         // drawn from the position-only stream, without material
+};
+
+// Collects the draws of a pass, sorts them by a packed 64-bit key and submits them, skipping every bind that
+// would not change anything. Opaque items come first, grouped by program, material and vertex array and within
+// a group front to back, so early depth testing rejects hidden fragments. Transparent items (materials with an
+// opacity below 1) follow back to front with blending enabled, which is off for everything else:
+//
+//   opaque:      0 | program 8 | material 16 | vertex array 16 | depth 23
+//   transparent: 1 | far-to-near depth 23 | program 8 | material 16 | vertex array 16
+//
+// Program, material and vertex array keys are truncated names (see Material::SortKey); a collision only costs a
+// bind, as Submit compares the real state. The shaders and meshes of queued items must outlive Submit().
+class RenderQueue
+{
+public:
+    // starts a pass; the items of the previous one are dropped, their storage kept.
+    void Clear()
+    {
+        items.clear();
+        transforms.clear();
+    }
+
+    // adds the transform the following items are drawn with, returns it for Add.
+    unsigned int AddTransform(const glm::mat4 &model)
+    {
+        transforms.push_back(model);
+        return (unsigned int)transforms.size() - 1;
+    }
+
+    // queues a mesh. depth is its distance to the viewer, which orders the items within a state group.
+    void Add(const Shader &shader, const Mesh &mesh, unsigned int transform, unsigned int lod, float depth, bool depthOnly)
+    {
+        DrawItem item;
+        item.shader = &shader;
+        item.mesh = &mesh;
+        item.transform = transform;
+        item.lod = lod;
+        item.depthOnly = depthOnly;
+        uint64_t program = shader.ID & 0xFFu;
+        uint64_t material = depthOnly ? 0 : mesh.material.SortKey();
+        uint64_t vertexArray = mesh.VertexArray(depthOnly) & 0xFFFFu;
+        uint64_t distance = depthBits(depth);
+        if (!depthOnly && mesh.material.Transparent())
+            item.key = 1ull << 63 | (~distance & 0x7FFFFFu) << 40 | program << 32 | material << 16 | vertexArray;
+        else
+            item.key = program << 55 | material << 39 | vertexArray << 23 | distance;
+        items.push_back(item);
+    }
+
+    // sorts the queued items and draws them.
+    void Submit()
+    {
+        sort(items.begin(), items.end(), [](const DrawItem &a, const DrawItem &b) { return a.key < b.key; });
+
+        static const Uniform<glm::mat4> modelUniform("model");
+        static const Uniform<bool> quantizedNormals("quantizedNormals");
+        unsigned int boundProgram = ~0u;
+        unsigned int boundVertexArray = ~0u;
+        unsigned int boundTransform = ~0u;
+        int boundLayout = -1;
+        bool blending = false;
+        MaterialBindings boundMaterial;
+        for (const DrawItem &item : items)
+        {
+            bool depthOnly = item.depthOnly;
+            if (item.shader->ID != boundProgram)
+            {
+                // uniforms are program state, so what was set through the previous program is set again
+                glUseProgram(item.shader->ID);
+                boundProgram = item.shader->ID;
+                boundTransform = ~0u;
+                boundLayout = -1;
+            }
+            bool transparent = !depthOnly && item.mesh->material.Transparent();
+            if (transparent != blending)
+            {
+                if (transparent)
+                {
+                    glEnable(GL_BLEND);
+                    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+                    glDepthMask(GL_FALSE);
+                }
+                else
+                {
+                    glDisable(GL_BLEND);
+                    glDepthMask(GL_TRUE);
+                }
+                blending = transparent;
+            }
+            if (!depthOnly)
+                item.mesh->material.Bind(boundMaterial);
+            unsigned int vertexArray = item.mesh->VertexArray(depthOnly);
+            if (vertexArray != boundVertexArray)
+            {
+                glBindVertexArray(vertexArray);
+                boundVertexArray = vertexArray;
+            }
+            if (item.transform != boundTransform)
+            {
+                item.shader->set(modelUniform, transforms[item.transform]);
+                boundTransform = item.transform;
+            }
+            item.mesh->SetVertexUniforms(*item.shader);
+            if (!depthOnly && (int)item.mesh->layout != boundLayout)
+            {
+                item.shader->set(quantizedNormals, item.mesh->layout == VertexLayout::Quantized);
+                boundLayout = (int)item.mesh->layout;
+            }
+            item.mesh->DrawElements(item.lod);
+        }
+        if (blending)
+        {
+            glDisable(GL_BLEND);
+            glDepthMask(GL_TRUE);
+        }
+        glBindVertexArray(0);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    size_t Size() const { return items.size(); }
+
+private:
+    vector<DrawItem> items;
+    vector<glm::mat4> transforms;
+
+    // the top 23 bits of a non-negative float (sign, exponent and 14 mantissa bits), which order like the value
+    static uint64_t depthBits(float depth)
+    {
+        depth = std::max(depth, 0.0f);
+        uint32_t bits;
+        memcpy(&bits, &depth, sizeof(bits));
+        return bits >> 9;
+    }
+};
+#endif
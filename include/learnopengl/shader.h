@@ -4,104 +4,158 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <learnopengl/shader_cache.h>
+#include <learnopengl/trace.h>
+#include <learnopengl/uniform.h>
+#include <learnopengl/vfs.h>
+
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <utility>
+#include <vector>
 #include <common.h>
+
+// a program whose compiles and link have been submitted to the driver but not checked yet, see Shader::BeginBuild.
+struct ShaderBuild {
+    unsigned int program = 0;
+    unsigned int stages[3] = {0, 0, 0}; // vertex, fragment and geometry shader; 0 for a missing geometry stage
+    uint64_t cacheKey = 0;
+    bool cached = false;                // loaded from the program binary cache, there is nothing to check
+};
+
+class ShaderBatch;
+
 class Shader
 {
 public:
     unsigned int ID;
+    // source files the program was built from, kept so it can be rebuilt when they change (see hot_reload.h)
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::string geometryPath; // empty without a geometry stage
     // constructor generates the shader on the fly
     // ------------------------------------------------------------------------
     Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
+        : vertexPath(vertexPath), fragmentPath(fragmentPath), geometryPath(geometryPath ? geometryPath : "")
     {
-        std::string vertexPathString(vertexPath);
-        std::string fragmentPathString(fragmentPath);
-
-        vertexPath = vertexPathString.c_str();
-        fragmentPath= fragmentPathString.c_str();
+        TraceScope trace("Shader", this->vertexPath);
         // 1. retrieve the vertex/fragment source code from filePath
         std::string vertexCode;
         std::string fragmentCode;
         std::string geometryCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-        std::ifstream gShaderFile;
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        gShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        try 
+        if (!ReadSources(this->vertexPath, this->fragmentPath, this->geometryPath, vertexCode, fragmentCode, geometryCode))
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+        // 2. compile shaders
+        ID = Build(vertexCode, fragmentCode, geometryCode);
+    }
+    // reads the sources and submits the build to batch; ID stays 0 until the batch completes it, and the shader
+    // must stay where it is until then.
+    // ------------------------------------------------------------------------
+    Shader(ShaderBatch &batch, const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr);
+    // reads the source files of a program; an empty geometryPath leaves geometryCode empty.
+    // ------------------------------------------------------------------------
+    static bool ReadSources(const std::string &vertexPath, const std::string &fragmentPath, const std::string &geometryPath,
+                            std::string &vertexCode, std::string &fragmentCode, std::string &geometryCode)
+    {
+        TraceScope trace("Shader::ReadSources", vertexPath);
+        // read through the VirtualFileSystem, so sources may come from an asset pack
+        VirtualFileSystem &vfs = VirtualFileSystem::Instance();
+        if (!vfs.Read(vertexPath, vertexCode) || !vfs.Read(fragmentPath, fragmentCode))
+            return false;
+        // if geometry shader path is present, also load a geometry shader
+        geometryCode.clear();
+        if (!geometryPath.empty() && !vfs.Read(geometryPath, geometryCode))
+            return false;
+        return true;
+    }
+    // compiles and links a program from source code, an empty geometryCode skips the geometry stage. Returns the
+    // program, which is 0 when compiling or linking failed and success is requested. Linked programs are kept in
+    // the program binary cache (see shader_cache.h), later builds of the same sources load them from there.
+    // ------------------------------------------------------------------------
+    static unsigned int Build(const std::string &vertexCode, const std::string &fragmentCode, const std::string &geometryCode,
+                              bool *success = nullptr)
+    {
+        ShaderBuild build = BeginBuild(vertexCode, fragmentCode, geometryCode);
+        return FinishBuild(build, success);
+    }
+    // submits the compiles and the link of a program without asking for their status, which would make the
+    // driver finish them right away. Submit every program before finishing any so they compile concurrently.
+    // ------------------------------------------------------------------------
+    static ShaderBuild BeginBuild(const std::string &vertexCode, const std::string &fragmentCode, const std::string &geometryCode)
+    {
+        TraceScope trace("Shader::BeginBuild");
+        ShaderBuild build;
+        build.cacheKey = ProgramCacheKey(vertexCode, fragmentCode, geometryCode);
+        build.program = ReadProgramCache(build.cacheKey);
+        if (build.program)
         {
-            // open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();		
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();			
-            // if geometry shader path is present, also load a geometry shader
-            if(geometryPath != nullptr)
-            {
-                std::string geometryPathString(geometryPath);
-                geometryPath = geometryPathString.c_str();
-                gShaderFile.open(geometryPath);
-                std::stringstream gShaderStream;
-                gShaderStream << gShaderFile.rdbuf();
-                gShaderFile.close();
-                geometryCode = gShaderStream.str();
-            }
+            build.cached = true;
+            return build;
         }
-        catch (std::ifstream::failure& e)
+        const std::string *codes[3] = {&vertexCode, &fragmentCode, &geometryCode};
+        const GLenum types[3] = {GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, GL_GEOMETRY_SHADER};
+        build.program = glCreateProgram();
+        PrepareProgramCache(build.program);
+        for (int i = 0; i < 3; i++)
         {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+            // if geometry shader is given, compile geometry shader
+            if (codes[i]->empty() && types[i] == GL_GEOMETRY_SHADER)
+                continue;
+            const char *code = codes[i]->c_str();
+            build.stages[i] = glCreateShader(types[i]);
+            glShaderSource(build.stages[i], 1, &code, NULL);
+            glCompileShader(build.stages[i]);
+            glAttachShader(build.program, build.stages[i]);
         }
-        const char* vShaderCode = vertexCode.c_str();
-        const char * fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
-        unsigned int vertex, fragment;
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-        // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
-        // if geometry shader is given, compile geometry shader
-        unsigned int geometry;
-        if(geometryPath != nullptr)
+        glLinkProgram(build.program);
+        return build;
+    }
+    // whether FinishBuild would return without waiting. Without GL_KHR_parallel_shader_compile there is no way
+    // to ask, so builds always report ready.
+    // ------------------------------------------------------------------------
+    static bool BuildReady(const ShaderBuild &build)
+    {
+        if (build.cached || !ParallelShaderCompileSupported())
+            return true;
+        GLint completed = GL_FALSE;
+        glGetProgramiv(build.program, GL_COMPLETION_STATUS_KHR, &completed);
+        return completed == GL_TRUE;
+    }
+    // checks the stages and the link of a submitted program, waiting for the driver if it has not finished yet.
+    // Returns the program like Build().
+    // ------------------------------------------------------------------------
+    static unsigned int FinishBuild(ShaderBuild &build, bool *success = nullptr)
+    {
+        TraceScope trace("Shader::FinishBuild");
+        bool ok = true;
+        if (!build.cached)
         {
-            const char * gShaderCode = geometryCode.c_str();
-            geometry = glCreateShader(GL_GEOMETRY_SHADER);
-            glShaderSource(geometry, 1, &gShaderCode, NULL);
-            glCompileShader(geometry);
-            checkCompileErrors(geometry, "GEOMETRY");
+            const char *types[3] = {"VERTEX", "FRAGMENT", "GEOMETRY"};
+            for (int i = 0; i < 3; i++)
+                if (build.stages[i])
+                    ok &= checkCompileErrors(build.stages[i], types[i]);
+            ok &= checkCompileErrors(build.program, "PROGRAM");
+            // delete the shaders as they're linked into our program now and no longer necessery
+            for (int i = 0; i < 3; i++)
+                if (build.stages[i])
+                    glDeleteShader(build.stages[i]);
+            if (ok)
+                WriteProgramCache(build.cacheKey, build.program);
         }
-        // shader Program
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        if(geometryPath != nullptr)
-            glAttachShader(ID, geometry);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
-        // delete the shaders as they're linked into our program now and no longer necessery
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-        if(geometryPath != nullptr)
-            glDeleteShader(geometry);
-
+        unsigned int program = build.program;
+        build = ShaderBuild();
+        if (success)
+        {
+            *success = ok;
+            if (!ok)
+            {
+                glDeleteProgram(program);
+                return 0;
+            }
+        }
+        return program;
     }
     // activate the shader
     // ------------------------------------------------------------------------
@@ -113,65 +167,81 @@ public:
     // ------------------------------------------------------------------------
     void setBool(const std::string &name, bool value) const
     {         
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+        glUniform1i(location(name), (int)value); 
     }
     // ------------------------------------------------------------------------
     void setInt(const std::string &name, int value) const
     { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1i(location(name), value); 
     }
     // ------------------------------------------------------------------------
     void setFloat(const std::string &name, float value) const
     { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1f(location(name), value); 
     }
     // ------------------------------------------------------------------------
     void setVec2(const std::string &name, const glm::vec2 &value) const
     { 
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform2fv(location(name), 1, &value[0]); 
     }
     void setVec2(const std::string &name, float x, float y) const
     { 
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y); 
+        glUniform2f(location(name), x, y); 
     }
     // ------------------------------------------------------------------------
     void setVec3(const std::string &name, const glm::vec3 &value) const
     { 
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform3fv(location(name), 1, &value[0]); 
     }
     void setVec3(const std::string &name, float x, float y, float z) const
     { 
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+        glUniform3f(location(name), x, y, z); 
     }
     // ------------------------------------------------------------------------
     void setVec4(const std::string &name, const glm::vec4 &value) const
     { 
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform4fv(location(name), 1, &value[0]); 
     }
     void setVec4(const std::string &name, float x, float y, float z, float w) 
     { 
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w); 
+        glUniform4f(location(name), x, y, z, w); 
     }
     // ------------------------------------------------------------------------
     void setMat2(const std::string &name, const glm::mat2 &mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix2fv(location(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat3(const std::string &name, const glm::mat3 &mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix3fv(location(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat4(const std::string &name, const glm::mat4 &mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix4fv(location(name), 1, GL_FALSE, &mat[0][0]);
     }
+    // typed uniform functions, for uniforms set every frame: no string is built and no location looked up
+    // ------------------------------------------------------------------------
+    void set(const Uniform<bool> &uniform, bool value) const { glUniform1i(location(uniform), (int)value); }
+    void set(const Uniform<int> &uniform, int value) const { glUniform1i(location(uniform), value); }
+    void set(const Uniform<float> &uniform, float value) const { glUniform1f(location(uniform), value); }
+    void set(const Uniform<glm::vec2> &uniform, const glm::vec2 &value) const { glUniform2fv(location(uniform), 1, &value[0]); }
+    void set(const Uniform<glm::vec3> &uniform, const glm::vec3 &value) const { glUniform3fv(location(uniform), 1, &value[0]); }
+    void set(const Uniform<glm::vec4> &uniform, const glm::vec4 &value) const { glUniform4fv(location(uniform), 1, &value[0]); }
+    void set(const Uniform<glm::mat2> &uniform, const glm::mat2 &mat) const { glUniformMatrix2fv(location(uniform), 1, GL_FALSE, &mat[0][0]); }
+    void set(const Uniform<glm::mat3> &uniform, const glm::mat3 &mat) const { glUniformMatrix3fv(location(uniform), 1, GL_FALSE, &mat[0][0]); }
+    void set(const Uniform<glm::mat4> &uniform, const glm::mat4 &mat) const { glUniformMatrix4fv(location(uniform), 1, GL_FALSE, &mat[0][0]); }
+    // location of a uniform in the current program, from its table (see uniform.h); -1 if the program lacks it
+    // ------------------------------------------------------------------------
+    GLint location(const std::string &name) const { return ProgramUniforms::Of(ID).Location(name); }
+    template <typename T>
+    GLint location(const Uniform<T> &uniform) const { return ProgramUniforms::Of(ID).Location(uniform); }
 
 private:
-    // utility function for checking shader compilation/linking errors.
+    // utility function for checking shader compilation/linking errors; returns whether it succeeded.
     // ------------------------------------------------------------------------
-    void checkCompileErrors(GLuint shader, std::string type)
+    static bool checkCompileErrors(GLuint shader, std::string type)
     {
         GLint success;
         GLchar infoLog[1024];
@@ -193,6 +263,64 @@ private:
                 std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
             }
         }
+        return success;
+    }
+};
+
+// Builds several shaders together: every compile and link is submitted before any status is queried, so the
+// driver works on all of them at once (on its own threads where GL_KHR_parallel_shader_compile is available)
+// while the caller carries on with other setup. Update() completes the shaders that are ready without blocking,
+// Finish() waits for the rest.
+class ShaderBatch
+{
+public:
+    void Add(Shader &shader, const std::string &vertexCode, const std::string &fragmentCode, const std::string &geometryCode)
+    {
+        shader.ID = 0;
+        pending.push_back(std::make_pair(&shader, Shader::BeginBuild(vertexCode, fragmentCode, geometryCode)));
+    }
+
+    // completes the shaders whose build has finished, returns how many.
+    unsigned int Update()
+    {
+        unsigned int completed = 0;
+        for (auto it = pending.begin(); it != pending.end();)
+        {
+            if (!Shader::BuildReady(it->second))
+            {
+                ++it;
+                continue;
+            }
+            it->first->ID = Shader::FinishBuild(it->second);
+            it = pending.erase(it);
+            completed++;
+        }
+        return completed;
+    }
+
+    void Finish()
+    {
+        TraceScope trace("ShaderBatch::Finish");
+        for (auto &build : pending)
+            build.first->ID = Shader::FinishBuild(build.second);
+        pending.clear();
     }
+
+    bool Idle() const { return pending.empty(); }
+
+private:
+    std::vector<std::pair<Shader *, ShaderBuild>> pending;
 };
+
+inline Shader::Shader(ShaderBatch &batch, const char* vertexPath, const char* fragmentPath, const char* geometryPath)
+    : ID(0), vertexPath(vertexPath), fragmentPath(fragmentPath), geometryPath(geometryPath ? geometryPath : "")
+{
+    TraceScope trace("Shader", this->vertexPath);
+    std::string vertexCode;
+    std::string fragmentCode;
+    std::string geometryCode;
+    if (!ReadSources(this->vertexPath, this->fragmentPath, this->geometryPath, vertexCode, fragmentCode, geometryCode))
+        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+    batch.Add(*this, vertexCode, fragmentCode, geometryCode);
+}
 #endif
@@ -0,0 +1,148 @@
+#ifndef SHADER_CACHE_H
+#define SHADER_CACHE_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/asset_cache.h>
+#include <learnopengl/gl_extensions.h>
+#include <learnopengl/trace.h>
+
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+using namespace std;
+
+// On-disk cache of linked program binaries (glGetProgramBinary), so launches after the first skip compiling and
+// linking. Entries are keyed by the stage sources (and with them every #define they contain) and the driver
+// strings: a driver update changes the key, and a binary the driver still rejects is recompiled from source.
+
+const uint32_t PROGRAM_CACHE_VERSION = 1;
+
+struct ProgramCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t binaryFormat;
+    uint32_t length;
+};
+
+// program binaries need GL 4.1 or ARB_get_program_binary and at least one binary format.
+inline bool ProgramCacheSupported()
+{
+    const GLExtensionFunctions &functions = GLExtensions();
+    if (!functions.GetProgramBinary || !functions.ProgramBinary || !functions.ProgramParameteri)
+        return false;
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+inline uint64_t programCacheHashString(const string &text, uint64_t hash)
+{
+    uint64_t length = text.size();
+    hash = AssetCacheHash(&length, sizeof(length), hash);
+    return AssetCacheHash(text.data(), text.size(), hash);
+}
+
+// key of a program: its stage sources and the vendor, renderer and version of the driver the context runs on.
+inline uint64_t ProgramCacheKey(const string &vertexCode, const string &fragmentCode, const string &geometryCode)
+{
+    uint64_t hash = AssetCacheHash(&PROGRAM_CACHE_VERSION, sizeof(PROGRAM_CACHE_VERSION));
+    for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION})
+    {
+        const char *value = (const char *)glGetString(name);
+        hash = programCacheHashString(value ? value : "", hash);
+    }
+    hash = programCacheHashString(vertexCode, hash);
+    hash = programCacheHashString(fragmentCode, hash);
+    return programCacheHashString(geometryCode, hash);
+}
+
+inline string ProgramCachePath(uint64_t key)
+{
+    char name[48];
+    snprintf(name, sizeof(name), "%016llx.lpb", (unsigned long long)key);
+    return string(ASSET_CACHE_DIRECTORY) + '/' + name;
+}
+
+// creates a program from its cached binary. Returns 0 on a miss or when the driver rejects the binary, which
+// also drops the entry.
+inline unsigned int ReadProgramCache(uint64_t key)
+{
+    if (!ProgramCacheSupported())
+        return 0;
+    TraceScope trace("ReadProgramCache");
+    string path = ProgramCachePath(key);
+    ifstream in(path, ios::binary);
+    ProgramCacheHeader header;
+    if (!in.read((char *)&header, sizeof(header)) || memcmp(header.magic, "LPB1", 4) != 0 || header.version != PROGRAM_CACHE_VERSION)
+        return 0;
+    vector<char> binary(header.length);
+    if (!in.read(binary.data(), binary.size()))
+        return 0;
+    unsigned int program = glCreateProgram();
+    GLExtensions().ProgramBinary(program, header.binaryFormat, binary.data(), (GLsizei)binary.size());
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked)
+    {
+        cout << "SHADER::CACHE:: program binary rejected by the driver, compiling from source" << endl;
+        glDeleteProgram(program);
+        remove(path.c_str());
+        return 0;
+    }
+    return program;
+}
+
+// asks the driver to keep the binary of a program retrievable; call before linking it.
+inline void PrepareProgramCache(unsigned int program)
+{
+    if (ProgramCacheSupported())
+        GLExtensions().ProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+// stores the binary of a successfully linked program. The file is written under a temporary name and renamed
+// into place, so readers never observe a partially written entry.
+inline bool WriteProgramCache(uint64_t key, unsigned int program)
+{
+    if (!ProgramCacheSupported())
+        return false;
+    TraceScope trace("WriteProgramCache");
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return false;
+    vector<char> binary((size_t)length);
+    GLenum format = 0;
+    GLsizei written = 0;
+    GLExtensions().GetProgramBinary(program, length, &written, &format, binary.data());
+    if (written <= 0)
+        return false;
+
+    ProgramCacheHeader header;
+    memcpy(header.magic, "LPB1", 4);
+    header.version = PROGRAM_CACHE_VERSION;
+    header.binaryFormat = format;
+    header.length = (uint32_t)written;
+    AssetCacheCreateDirectory();
+    string path = ProgramCachePath(key);
+    string temporaryPath = path + ".tmp" + to_string(getpid());
+    ofstream out(temporaryPath, ios::binary | ios::trunc);
+    if (!out)
+        return false;
+    out.write((const char *)&header, sizeof(header));
+    out.write(binary.data(), written);
+    out.close();
+    if (!out || rename(temporaryPath.c_str(), path.c_str()) != 0)
+    {
+        remove(temporaryPath.c_str());
+        return false;
+    }
+    return true;
+}
+#endif
@@ -0,0 +1,560 @@
+#ifndef TEXTURE_COMPRESSION_H
+#define TEXTURE_COMPRESSION_H
+
+#include <learnopengl/asset_cache.h>
+#include <learnopengl/trace.h>
+#include <learnopengl/vfs.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+// CPU block compression of textures plus the on-disk container ("ltc") that stores the compressed
+// mip chain, so transcoding happens once per source image instead of every launch.
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#endif
+
+enum class BlockFormat : uint32_t {
+    BC1 = 1, // RGB, 4 bits per texel
+    BC3 = 3, // RGBA (interpolated alpha), 8 bits per texel
+    BC4 = 4, // single channel, 4 bits per texel
+    BC5 = 5, // two channels (normal map X/Y), 8 bits per texel
+    BC7 = 7  // RGBA, high quality, 8 bits per texel
+};
+
+inline unsigned int BlockBytes(BlockFormat format)
+{
+    return (format == BlockFormat::BC1 || format == BlockFormat::BC4) ? 8 : 16;
+}
+
+inline unsigned int BlockFormatGL(BlockFormat format)
+{
+    switch (format)
+    {
+        case BlockFormat::BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        case BlockFormat::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case BlockFormat::BC4: return 0x8DBB; // GL_COMPRESSED_RED_RGTC1
+        case BlockFormat::BC5: return 0x8DBD; // GL_COMPRESSED_RG_RGTC2
+        case BlockFormat::BC7: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+    }
+    return 0;
+}
+
+inline const char *BlockFormatName(BlockFormat format)
+{
+    switch (format)
+    {
+        case BlockFormat::BC1: return "BC1";
+        case BlockFormat::BC3: return "BC3";
+        case BlockFormat::BC4: return "BC4";
+        case BlockFormat::BC5: return "BC5";
+        case BlockFormat::BC7: return "BC7";
+    }
+    return "?";
+}
+
+inline size_t CompressedLevelSize(BlockFormat format, int width, int height)
+{
+    return (size_t)((width + 3) / 4) * ((height + 3) / 4) * BlockBytes(format);
+}
+
+// ---------------------------------------------------------------------------------------------------------
+// block encoders, each takes a 4x4 block of RGBA8 texels in row order
+// ---------------------------------------------------------------------------------------------------------
+
+inline uint16_t packRGB565(const float color[3])
+{
+    int r = (int)std::lround(std::min(std::max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f);
+    int g = (int)std::lround(std::min(std::max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f);
+    int b = (int)std::lround(std::min(std::max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+inline void unpackRGB565(uint16_t packed, int color[3])
+{
+    int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+// principal axis of a set of points (power iteration on the covariance matrix); returns the mean as well.
+template <int N>
+inline void principalAxis(const float points[16][N], float mean[N], float axis[N])
+{
+    for (int c = 0; c < N; c++)
+    {
+        mean[c] = 0.0f;
+        for (int i = 0; i < 16; i++)
+            mean[c] += points[i][c];
+        mean[c] /= 16.0f;
+    }
+    float covariance[N][N] = {};
+    for (int i = 0; i < 16; i++)
+        for (int a = 0; a < N; a++)
+            for (int b = 0; b < N; b++)
+                covariance[a][b] += (points[i][a] - mean[a]) * (points[i][b] - mean[b]);
+    for (int c = 0; c < N; c++)
+        axis[c] = 1.0f;
+    for (int iteration = 0; iteration < 8; iteration++)
+    {
+        float next[N] = {};
+        float length = 0.0f;
+        for (int a = 0; a < N; a++)
+        {
+            for (int b = 0; b < N; b++)
+                next[a] += covariance[a][b] * axis[b];
+            length = std::max(length, std::fabs(next[a]));
+        }
+        if (length < 1e-6f)
+            break;
+        for (int c = 0; c < N; c++)
+            axis[c] = next[c] / length;
+    }
+}
+
+// BC1 in four-colour mode: endpoints at the extremes of the principal axis, nearest-palette indices.
+inline void EncodeBC1Block(const unsigned char texels[64], unsigned char out[8])
+{
+    float points[16][3];
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < 3; c++)
+            points[i][c] = texels[i * 4 + c];
+    float mean[3], axis[3];
+    principalAxis<3>(points, mean, axis);
+    float minT = 1e30f, maxT = -1e30f;
+    for (int i = 0; i < 16; i++)
+    {
+        float t = 0.0f;
+        for (int c = 0; c < 3; c++)
+            t += (points[i][c] - mean[c]) * axis[c];
+        minT = std::min(minT, t);
+        maxT = std::max(maxT, t);
+    }
+    float low[3], high[3];
+    for (int c = 0; c < 3; c++)
+    {
+        low[c] = mean[c] + axis[c] * minT;
+        high[c] = mean[c] + axis[c] * maxT;
+    }
+    uint16_t c0 = packRGB565(high), c1 = packRGB565(low);
+    if (c0 < c1)
+        std::swap(c0, c1);
+    uint32_t indices = 0;
+    if (c0 != c1)
+    {
+        int e0[3], e1[3], palette[4][3];
+        unpackRGB565(c0, e0);
+        unpackRGB565(c1, e1);
+        for (int c = 0; c < 3; c++)
+        {
+            palette[0][c] = e0[c];
+            palette[1][c] = e1[c];
+            palette[2][c] = (2 * e0[c] + e1[c]) / 3;
+            palette[3][c] = (e0[c] + 2 * e1[c]) / 3;
+        }
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0, bestError = 1 << 30;
+            for (int p = 0; p < 4; p++)
+            {
+                int error = 0;
+                for (int c = 0; c < 3; c++)
+                {
+                    int d = texels[i * 4 + c] - palette[p][c];
+                    error += d * d;
+                }
+                if (error < bestError)
+                {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices |= (uint32_t)best << (2 * i);
+        }
+    }
+    out[0] = c0 & 0xFF;
+    out[1] = c0 >> 8;
+    out[2] = c1 & 0xFF;
+    out[3] = c1 >> 8;
+    for (int i = 0; i < 4; i++)
+        out[4 + i] = (indices >> (8 * i)) & 0xFF;
+}
+
+// BC4 (also the alpha half of BC3 and each half of BC5) in eight-value mode.
+inline void EncodeBC4Block(const unsigned char texels[64], int channel, unsigned char out[8])
+{
+    int low = 255, high = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        low = std::min(low, (int)texels[i * 4 + channel]);
+        high = std::max(high, (int)texels[i * 4 + channel]);
+    }
+    out[0] = (unsigned char)high;
+    out[1] = (unsigned char)low;
+    uint64_t indices = 0;
+    if (high != low)
+    {
+        int palette[8];
+        palette[0] = high;
+        palette[1] = low;
+        for (int p = 1; p < 7; p++)
+            palette[p + 1] = ((7 - p) * high + p * low) / 7;
+        for (int i = 0; i < 16; i++)
+        {
+            int value = texels[i * 4 + channel];
+            int best = 0, bestError = 1 << 30;
+            for (int p = 0; p < 8; p++)
+            {
+                int error = std::abs(value - palette[p]);
+                if (error < bestError)
+                {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices |= (uint64_t)best << (3 * i);
+        }
+    }
+    for (int i = 0; i < 6; i++)
+        out[2 + i] = (indices >> (8 * i)) & 0xFF;
+}
+
+inline void EncodeBC3Block(const unsigned char texels[64], unsigned char out[16])
+{
+    EncodeBC4Block(texels, 3, out);
+    EncodeBC1Block(texels, out + 8);
+}
+
+inline void EncodeBC5Block(const unsigned char texels[64], unsigned char out[16])
+{
+    EncodeBC4Block(texels, 0, out);
+    EncodeBC4Block(texels, 1, out + 8);
+}
+
+// BC7 mode 6: one subset, RGBA endpoints with 7 bits + a unique p-bit each, 4-bit indices.
+inline void EncodeBC7Block(const unsigned char texels[64], unsigned char out[16])
+{
+    static const int weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+    float points[16][4];
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < 4; c++)
+            points[i][c] = texels[i * 4 + c];
+    float mean[4], axis[4];
+    principalAxis<4>(points, mean, axis);
+    float minT = 1e30f, maxT = -1e30f;
+    for (int i = 0; i < 16; i++)
+    {
+        float t = 0.0f;
+        for (int c = 0; c < 4; c++)
+            t += (points[i][c] - mean[c]) * axis[c];
+        minT = std::min(minT, t);
+        maxT = std::max(maxT, t);
+    }
+
+    // try every p-bit combination and keep the one with the lowest error
+    int bestEndpoints[2][4] = {}, bestPBits[2] = {}, bestIndices[16] = {};
+    long bestError = -1;
+    for (int pbits = 0; pbits < 4; pbits++)
+    {
+        int p[2] = {pbits & 1, pbits >> 1};
+        int quantized[2][4], expanded[2][4];
+        for (int e = 0; e < 2; e++)
+            for (int c = 0; c < 4; c++)
+            {
+                float value = mean[c] + axis[c] * (e == 0 ? minT : maxT);
+                int q = (int)std::lround((std::min(std::max(value, 0.0f), 255.0f) - p[e]) / 2.0f);
+                quantized[e][c] = std::min(std::max(q, 0), 127);
+                expanded[e][c] = (quantized[e][c] << 1) | p[e];
+            }
+        int palette[16][4];
+        for (int w = 0; w < 16; w++)
+            for (int c = 0; c < 4; c++)
+                palette[w][c] = ((64 - weights[w]) * expanded[0][c] + weights[w] * expanded[1][c] + 32) >> 6;
+        long error = 0;
+        int indices[16];
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0, bestTexelError = 1 << 30;
+            for (int w = 0; w < 16; w++)
+            {
+                int texelError = 0;
+                for (int c = 0; c < 4; c++)
+                {
+                    int d = texels[i * 4 + c] - palette[w][c];
+                    texelError += d * d;
+                }
+                if (texelError < bestTexelError)
+                {
+                    bestTexelError = texelError;
+                    best = w;
+                }
+            }
+            indices[i] = best;
+            error += bestTexelError;
+        }
+        if (bestError < 0 || error < bestError)
+        {
+            bestError = error;
+            memcpy(bestEndpoints, quantized, sizeof(bestEndpoints));
+            bestPBits[0] = p[0];
+            bestPBits[1] = p[1];
+            memcpy(bestIndices, indices, sizeof(bestIndices));
+        }
+    }
+    // the anchor index is stored with an implicit zero MSB, swap the endpoints if needed
+    if (bestIndices[0] & 8)
+    {
+        for (int c = 0; c < 4; c++)
+            std::swap(bestEndpoints[0][c], bestEndpoints[1][c]);
+        std::swap(bestPBits[0], bestPBits[1]);
+        for (int i = 0; i < 16; i++)
+            bestIndices[i] = 15 - bestIndices[i];
+    }
+
+    memset(out, 0, 16);
+    int bit = 0;
+    auto write = [&out, &bit](uint32_t value, int count) {
+        for (int i = 0; i < count; i++, bit++)
+            out[bit >> 3] |= ((value >> i) & 1) << (bit & 7);
+    };
+    write(1 << 6, 7); // mode 6
+    for (int c = 0; c < 4; c++)
+    {
+        write(bestEndpoints[0][c], 7);
+        write(bestEndpoints[1][c], 7);
+    }
+    write(bestPBits[0], 1);
+    write(bestPBits[1], 1);
+    write(bestIndices[0], 3);
+    for (int i = 1; i < 16; i++)
+        write(bestIndices[i], 4);
+}
+
+// ---------------------------------------------------------------------------------------------------------
+// mip chain generation and compression
+// ---------------------------------------------------------------------------------------------------------
+
+struct CompressedLevel {
+    int width;
+    int height;
+    size_t offset; // into CompressedTexture::data
+    size_t size;
+};
+
+struct CompressedTexture {
+    BlockFormat format;
+    vector<CompressedLevel> levels;
+    vector<unsigned char> data;
+};
+
+// 2x2 box filter, edges clamp for odd sizes.
+inline vector<unsigned char> DownsampleRGBA(const vector<unsigned char> &source, int width, int height, int &outWidth, int &outHeight)
+{
+    outWidth = std::max(1, width / 2);
+    outHeight = std::max(1, height / 2);
+    vector<unsigned char> result((size_t)outWidth * outHeight * 4);
+    for (int y = 0; y < outHeight; y++)
+        for (int x = 0; x < outWidth; x++)
+        {
+            int x0 = std::min(2 * x, width - 1), x1 = std::min(2 * x + 1, width - 1);
+            int y0 = std::min(2 * y, height - 1), y1 = std::min(2 * y + 1, height - 1);
+            for (int c = 0; c < 4; c++)
+            {
+                int sum = source[((size_t)y0 * width + x0) * 4 + c] + source[((size_t)y0 * width + x1) * 4 + c]
+                          + source[((size_t)y1 * width + x0) * 4 + c] + source[((size_t)y1 * width + x1) * 4 + c];
+                result[((size_t)y * outWidth + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+            }
+        }
+    return result;
+}
+
+inline void compressLevel(const vector<unsigned char> &rgba, int width, int height, BlockFormat format, unsigned char *out)
+{
+    unsigned char block[64];
+    for (int by = 0; by < (height + 3) / 4; by++)
+        for (int bx = 0; bx < (width + 3) / 4; bx++)
+        {
+            // blocks that hang over the edge repeat the last row/column
+            for (int y = 0; y < 4; y++)
+                for (int x = 0; x < 4; x++)
+                {
+                    int sx = std::min(bx * 4 + x, width - 1), sy = std::min(by * 4 + y, height - 1);
+                    memcpy(block + (y * 4 + x) * 4, &rgba[((size_t)sy * width + sx) * 4], 4);
+                }
+            switch (format)
+            {
+                case BlockFormat::BC1: EncodeBC1Block(block, out); break;
+                case BlockFormat::BC3: EncodeBC3Block(block, out); break;
+                case BlockFormat::BC4: EncodeBC4Block(block, 0, out); break;
+                case BlockFormat::BC5: EncodeBC5Block(block, out); break;
+                case BlockFormat::BC7: EncodeBC7Block(block, out); break;
+            }
+            out += BlockBytes(format);
+        }
+}
+
+// compresses an RGBA8 image and its full mip chain.
+inline CompressedTexture CompressTexture(vector<unsigned char> rgba, int width, int height, BlockFormat format)
+{
+    TraceScope trace("CompressTexture", to_string(width) + "x" + to_string(height));
+    CompressedTexture texture;
+    texture.format = format;
+    for (;;)
+    {
+        CompressedLevel level;
+        level.width = width;
+        level.height = height;
+        level.offset = texture.data.size();
+        level.size = CompressedLevelSize(format, width, height);
+        texture.data.resize(level.offset + level.size);
+        compressLevel(rgba, width, height, format, &texture.data[level.offset]);
+        texture.levels.push_back(level);
+        if (width == 1 && height == 1)
+            break;
+        rgba = DownsampleRGBA(rgba, width, height, width, height);
+    }
+    return texture;
+}
+
+inline unsigned int MipLevelCount(int width, int height)
+{
+    unsigned int levels = 1;
+    while (width > 1 || height > 1)
+    {
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+        levels++;
+    }
+    return levels;
+}
+
+// drops the levels larger than maxSize (0 keeps all of them), always keeping the last one.
+inline void TrimTextureLevels(CompressedTexture &texture, int maxSize)
+{
+    size_t first = 0;
+    while (maxSize > 0 && first + 1 < texture.levels.size() && std::max(texture.levels[first].width, texture.levels[first].height) > maxSize)
+        first++;
+    if (first == 0)
+        return;
+    size_t base = texture.levels[first].offset;
+    texture.levels.erase(texture.levels.begin(), texture.levels.begin() + first);
+    for (CompressedLevel &level : texture.levels)
+        level.offset -= base;
+    texture.data.erase(texture.data.begin(), texture.data.begin() + base);
+}
+
+// ---------------------------------------------------------------------------------------------------------
+// container: header, level table, source path, compressed levels. Valid while the source file is unchanged.
+// ---------------------------------------------------------------------------------------------------------
+
+const uint32_t TEXTURE_CACHE_VERSION = 1;
+
+struct TextureCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t format;
+    uint32_t levelCount;
+    int64_t sourceMtime;
+    uint64_t sourceSize;
+    uint32_t sourcePathLength;
+    uint32_t reserved;
+};
+
+struct TextureCacheLevel {
+    uint32_t width;
+    uint32_t height;
+    uint64_t offset; // relative to the start of the level data
+    uint64_t size;
+};
+
+inline bool WriteTextureCache(const string &sourcePath, const CompressedTexture &texture)
+{
+    TraceScope trace("WriteTextureCache", sourcePath);
+    TextureCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "LTC1", 4);
+    header.version = TEXTURE_CACHE_VERSION;
+    header.format = (uint32_t)texture.format;
+    header.levelCount = (uint32_t)texture.levels.size();
+    header.sourcePathLength = (uint32_t)sourcePath.size();
+    if (!VirtualFileSystem::Instance().Stat(sourcePath, header.sourceMtime, header.sourceSize))
+        return false;
+
+    AssetCacheCreateDirectory();
+    string path = AssetCachePath(sourcePath + '#' + BlockFormatName(texture.format), "ltc");
+    string temporaryPath = path + ".tmp" + to_string(hash<thread::id>()(this_thread::get_id()));
+    ofstream out(temporaryPath, ios::binary | ios::trunc);
+    out.write((const char *)&header, sizeof(header));
+    for (const CompressedLevel &level : texture.levels)
+    {
+        TextureCacheLevel entry = {(uint32_t)level.width, (uint32_t)level.height, level.offset, level.size};
+        out.write((const char *)&entry, sizeof(entry));
+    }
+    out.write(sourcePath.data(), sourcePath.size());
+    out.write((const char *)texture.data.data(), texture.data.size());
+    out.close();
+    if (!out || rename(temporaryPath.c_str(), path.c_str()) != 0)
+    {
+        remove(temporaryPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+// reads a cached mip chain. A maxSize other than 0 only reads the levels no larger than that, e.g. for a preview.
+inline bool ReadTextureCache(const string &sourcePath, BlockFormat format, CompressedTexture &texture, int maxSize = 0)
+{
+    TraceScope trace("ReadTextureCache", sourcePath);
+    int64_t mtime;
+    uint64_t sourceSize;
+    if (!VirtualFileSystem::Instance().Stat(sourcePath, mtime, sourceSize))
+        return false;
+    ifstream in(AssetCachePath(sourcePath + '#' + BlockFormatName(format), "ltc"), ios::binary);
+    TextureCacheHeader header;
+    if (!in.read((char *)&header, sizeof(header)))
+        return false;
+    if (memcmp(header.magic, "LTC1", 4) != 0 || header.version != TEXTURE_CACHE_VERSION || header.format != (uint32_t)format
+        || header.sourceMtime != mtime || header.sourceSize != sourceSize || header.sourcePathLength != sourcePath.size()
+        || header.levelCount == 0 || header.levelCount > 32)
+        return false;
+    vector<TextureCacheLevel> entries(header.levelCount);
+    string storedPath(header.sourcePathLength, '\0');
+    if (!in.read((char *)entries.data(), entries.size() * sizeof(TextureCacheLevel)) || !in.read(&storedPath[0], storedPath.size())
+        || storedPath != sourcePath)
+        return false;
+    // levels are stored largest first, so the ones wanted are a tail of the level data
+    size_t first = 0;
+    while (maxSize > 0 && first + 1 < entries.size() && std::max(entries[first].width, entries[first].height) > (uint32_t)maxSize)
+        first++;
+    const TextureCacheLevel &last = entries.back();
+    uint64_t base = entries[first].offset;
+    if (base > last.offset)
+        return false;
+    texture.format = format;
+    texture.levels.clear();
+    texture.data.resize(last.offset + last.size - base);
+    for (size_t i = first; i < entries.size(); i++)
+    {
+        const TextureCacheLevel &entry = entries[i];
+        if (entry.offset < base || entry.offset - base + entry.size > texture.data.size())
+            return false;
+        texture.levels.push_back({(int)entry.width, (int)entry.height, (size_t)(entry.offset - base), (size_t)entry.size});
+    }
+    return in.seekg((streamoff)base, ios::cur) && in.read((char *)texture.data.data(), texture.data.size());
+}
+#endif
@@ -0,0 +1,464 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <glad/glad.h>
+#include <stb_image.h>
+
+#include <learnopengl/gl_extensions.h>
+#include <learnopengl/texture_compression.h>
+#include <learnopengl/thread_pool.h>
+#include <learnopengl/trace.h>
+#include <learnopengl/vfs.h>
+
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+using namespace std;
+
+enum class TextureUsage {
+    Color,
+    NormalMap // only X/Y are kept when compressed (BC5), Z has to be reconstructed when sampling
+};
+
+// decoded image as produced by a loader thread; either raw pixels or a block-compressed mip chain.
+struct DecodedImage {
+    unsigned char *pixels = nullptr;
+    int width = 0;
+    int height = 0;
+    int components = 0;
+    bool compressed = false;
+    CompressedTexture blocks;
+
+    ~DecodedImage() { if (pixels) stbi_image_free(pixels); }
+};
+
+// GPU memory of a loaded texture compared to what the uncompressed upload with a runtime mip chain takes.
+struct TextureMemoryStats {
+    size_t gpuBytes = 0;
+    size_t uncompressedBytes = 0;
+    float bitsPerTexel = 0.0f;
+    float uncompressedBitsPerTexel = 0.0f;
+    const char *format = "";
+    int width = 0;               // full resolution of the source image
+    int height = 0;
+    unsigned int levelCount = 0; // mip levels of the full chain
+    unsigned int baseLevel = 0;  // finest level of the full chain that is in VRAM
+    bool streamable = false;     // compressed: any part of the chain can be read back from the texture cache
+};
+
+// largest preview level, in texels: compressed textures first show their mip levels up to this size.
+const int TEXTURE_PREVIEW_SIZE = 64;
+
+// Asynchronous texture loading. Load() hands out a texture name immediately (backed by a 1x1 white
+// placeholder), decodes the image on the loader pool and Update() later streams the pixels into the
+// texture through a small ring of pixel buffer objects, so decoding of one image overlaps with the
+// upload of another. Everything except the decoding must run on the context thread.
+//
+// When the driver supports S3TC, images are transcoded once into block-compressed formats with a
+// prebuilt mip chain (see texture_compression.h) and later launches read the cached container instead:
+// BC1 for RGB, BC7 (BC3 without BPTC support) for RGBA, BC4 for single channel and BC5 for normal maps.
+// Compressed textures stream in two steps: the smallest mip levels are uploaded first as a preview, and
+// the full chain is decoded behind the previews of every texture requested so far.
+class TextureLoader
+{
+public:
+    static TextureLoader &Instance()
+    {
+        static TextureLoader loader;
+        return loader;
+    }
+
+    bool compress; // transcode to block-compressed formats when supported
+
+    // returns a texture name right away; its contents are filled in by a later Update(). maxSize other than 0
+    // limits compressed textures to the mip levels no larger than that, see TextureResidency.
+    unsigned int Load(const string &filename, TextureUsage usage = TextureUsage::Color, int maxSize = 0)
+    {
+        unsigned int textureID;
+        glGenTextures(1, &textureID);
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        const unsigned char white[4] = {255, 255, 255, 255};
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        requestDecode(textureID, filename, usage, maxSize, true);
+        return textureID;
+    }
+
+    // loads the file again into an existing texture, for compressed textures only the mip levels no larger than
+    // maxSize (0 for all), read from the texture cache unless the file changed. Used to stream finer levels in, to
+    // evict them again and to reload changed files; the texture is sampled as before until Update() replaces it.
+    void Stream(unsigned int textureID, const string &filename, TextureUsage usage, int maxSize)
+    {
+        Forget(textureID);
+        requestDecode(textureID, filename, usage, maxSize, false);
+    }
+
+    bool Pending(unsigned int textureID) const
+    {
+        for (const PendingTexture &request : pending)
+            if (request.id == textureID)
+                return true;
+        return false;
+    }
+
+    // uploads every texture whose decode has finished, stopping once uploadBudgetBytes have been streamed
+    // (at least one texture is always uploaded). Returns the number of textures completed.
+    unsigned int Update(size_t uploadBudgetBytes = 64u << 20)
+    {
+        unsigned int completed = 0;
+        size_t uploaded = 0;
+        for (auto it = pending.begin(); it != pending.end() && (completed == 0 || uploaded < uploadBudgetBytes);)
+        {
+            if (it->image.wait_for(chrono::seconds(0)) != future_status::ready)
+            {
+                if (!it->previewShown && it->preview.wait_for(chrono::seconds(0)) == future_status::ready)
+                {
+                    shared_ptr<DecodedImage> preview = it->preview.get();
+                    it->previewShown = true;
+                    if (preview)
+                        uploaded += upload(it->id, it->path, *preview);
+                }
+                ++it;
+                continue;
+            }
+            uploaded += upload(it->id, it->path, *it->image.get());
+            it = pending.erase(it);
+            completed++;
+        }
+        return completed;
+    }
+
+    // blocks until every requested texture has been decoded and uploaded.
+    void Finish()
+    {
+        while (!pending.empty())
+        {
+            pending.front().image.wait();
+            Update();
+        }
+    }
+
+    bool Idle() const { return pending.empty(); }
+
+    // stops tracking a texture that is about to be deleted; a decode still in flight is discarded.
+    void Forget(unsigned int textureID)
+    {
+        for (auto it = pending.begin(); it != pending.end(); ++it)
+            if (it->id == textureID)
+            {
+                pending.erase(it);
+                break;
+            }
+        stats.erase(textureID);
+    }
+
+    // memory statistics of a texture that has finished loading, nullptr otherwise.
+    const TextureMemoryStats *Stats(unsigned int textureID) const
+    {
+        auto it = stats.find(textureID);
+        return it != stats.end() ? &it->second : nullptr;
+    }
+
+private:
+    struct PendingTexture {
+        unsigned int id;
+        string path;
+        future<shared_ptr<DecodedImage>> preview; // nullptr when there is none
+        future<shared_ptr<DecodedImage>> image;
+        bool previewShown;
+    };
+
+    struct DecodeResults {
+        promise<shared_ptr<DecodedImage>> preview;
+        promise<shared_ptr<DecodedImage>> image;
+    };
+
+    static const unsigned int PBO_COUNT = 3;
+
+    deque<PendingTexture> pending;
+    unordered_map<unsigned int, TextureMemoryStats> stats;
+    unsigned int pbos[PBO_COUNT];
+    unsigned int nextPbo;
+    bool s3tcSupported;
+    bool bptcSupported;
+
+    TextureLoader() : compress(true), nextPbo(0)
+    {
+        glGenBuffers(PBO_COUNT, pbos);
+        s3tcSupported = HasGLExtension("GL_EXT_texture_compression_s3tc");
+        bptcSupported = HasGLVersion(4, 2) || HasGLExtension("GL_ARB_texture_compression_bptc");
+    }
+
+    void requestDecode(unsigned int textureID, const string &filename, TextureUsage usage, int maxSize, bool preview)
+    {
+        PendingTexture request;
+        request.id = textureID;
+        request.path = filename;
+        request.previewShown = false;
+        shared_ptr<DecodeResults> results = make_shared<DecodeResults>();
+        request.preview = results->preview.get_future();
+        request.image = results->image.get_future();
+        bool bptc = bptcSupported;
+        if (compress && s3tcSupported)
+            ThreadPool::Loaders().Submit([filename, usage, bptc, maxSize, preview, results] {
+                decodeCompressed(filename, usage, bptc, maxSize, preview, results);
+            });
+        else
+            ThreadPool::Loaders().Submit([filename, results] {
+                results->preview.set_value(nullptr);
+                results->image.set_value(decode(filename));
+            });
+        pending.push_back(std::move(request));
+    }
+
+    static shared_ptr<DecodedImage> decode(const string &filename)
+    {
+        shared_ptr<DecodedImage> image = make_shared<DecodedImage>();
+        image->pixels = loadImage(filename, &image->width, &image->height, &image->components, 0);
+        return image;
+    }
+
+    // stbi_load and stbi_info reading through the VirtualFileSystem.
+    static unsigned char *loadImage(const string &filename, int *width, int *height, int *components, int desiredComponents)
+    {
+        TraceScope trace("stbi_load", filename);
+        VfsFile file = VirtualFileSystem::Instance().Open(filename);
+        if (!file)
+            return nullptr;
+        return stbi_load_from_memory((const stbi_uc *)file.data(), (int)file.size(), width, height, components, desiredComponents);
+    }
+
+    static bool imageInfo(const string &filename, int *width, int *height, int *components)
+    {
+        VfsFile file = VirtualFileSystem::Instance().Open(filename);
+        return file && stbi_info_from_memory((const stbi_uc *)file.data(), (int)file.size(), width, height, components);
+    }
+
+    // loads the compressed mip chain (its levels up to maxSize, unless 0) from the texture cache, transcoding
+    // and caching the full chain on a miss. With preview, the preview is published first and the rest of the
+    // work is queued, so it runs after the previews of other textures.
+    static void decodeCompressed(const string &filename, TextureUsage usage, bool bptc, int maxSize, bool preview,
+                                 shared_ptr<DecodeResults> results)
+    {
+        shared_ptr<DecodedImage> image = make_shared<DecodedImage>();
+        if (!imageInfo(filename, &image->width, &image->height, &image->components))
+        {
+            results->preview.set_value(nullptr);
+            results->image.set_value(image);
+            return;
+        }
+        BlockFormat format;
+        if (usage == TextureUsage::NormalMap || image->components == 2)
+            format = BlockFormat::BC5;
+        else if (image->components == 1)
+            format = BlockFormat::BC4;
+        else if (image->components == 3)
+            format = BlockFormat::BC1;
+        else
+            format = bptc ? BlockFormat::BC7 : BlockFormat::BC3;
+        image->compressed = true;
+        // a single step when no preview is wanted or the result would be no larger than one
+        bool singleStep = !preview || std::max(image->width, image->height) <= TEXTURE_PREVIEW_SIZE
+                          || (maxSize > 0 && maxSize <= TEXTURE_PREVIEW_SIZE);
+
+        CompressedTexture previewBlocks;
+        if (!singleStep && ReadTextureCache(filename, format, previewBlocks, TEXTURE_PREVIEW_SIZE))
+        {
+            results->preview.set_value(previewImage(*image, std::move(previewBlocks)));
+            ThreadPool::Loaders().Submit([filename, format, maxSize, image, results] {
+                if (ReadTextureCache(filename, format, image->blocks, maxSize))
+                    results->image.set_value(image);
+                else
+                    results->image.set_value(decode(filename)); // the file changed in between
+            });
+            return;
+        }
+        if (singleStep && ReadTextureCache(filename, format, image->blocks, maxSize))
+        {
+            results->preview.set_value(nullptr);
+            results->image.set_value(image);
+            return;
+        }
+
+        int width, height, components;
+        unsigned char *rgba = loadImage(filename, &width, &height, &components, 4);
+        if (!rgba)
+        {
+            image->compressed = false;
+            results->preview.set_value(nullptr);
+            results->image.set_value(image);
+            return;
+        }
+        vector<unsigned char> pixels(rgba, rgba + (size_t)width * height * 4);
+        stbi_image_free(rgba);
+        if (singleStep)
+            results->preview.set_value(nullptr);
+        else
+        {
+            // the few preview levels compress in no time, the full chain is what takes long
+            vector<unsigned char> previewPixels = pixels;
+            int previewWidth = width, previewHeight = height;
+            while (std::max(previewWidth, previewHeight) > TEXTURE_PREVIEW_SIZE)
+                previewPixels = DownsampleRGBA(previewPixels, previewWidth, previewHeight, previewWidth, previewHeight);
+            results->preview.set_value(previewImage(*image, CompressTexture(std::move(previewPixels), previewWidth, previewHeight, format)));
+        }
+        ThreadPool::Loaders().Submit([filename, format, maxSize, image, results, width, height, pixels = std::move(pixels)]() mutable {
+            // the cache always holds the full chain, only the upload is limited to maxSize
+            image->blocks = CompressTexture(std::move(pixels), width, height, format);
+            WriteTextureCache(filename, image->blocks);
+            TrimTextureLevels(image->blocks, maxSize);
+            results->image.set_value(image);
+        });
+    }
+
+    static shared_ptr<DecodedImage> previewImage(const DecodedImage &image, CompressedTexture blocks)
+    {
+        shared_ptr<DecodedImage> preview = make_shared<DecodedImage>();
+        preview->width = image.width;
+        preview->height = image.height;
+        preview->components = image.components;
+        preview->compressed = true;
+        preview->blocks = std::move(blocks);
+        return preview;
+    }
+
+    // copies the pixels into the next PBO of the ring and specifies the texture from it; the transfer to
+    // the texture then proceeds asynchronously. Returns the number of bytes streamed.
+    size_t upload(unsigned int textureID, const string &path, const DecodedImage &image)
+    {
+        TraceScope trace("TextureLoader::upload", path);
+        if (image.compressed)
+            return uploadCompressed(textureID, image);
+        if (!image.pixels)
+        {
+            std::cout << "Texture failed to load at path: " << path << std::endl;
+            return 0;
+        }
+        GLenum format = GL_RGBA;
+        if (image.components == 1)
+            format = GL_RED;
+        else if (image.components == 2)
+            format = GL_RG;
+        else if (image.components == 3)
+            format = GL_RGB;
+        size_t size = (size_t)image.width * image.height * image.components;
+
+        // orphan the buffer before mapping so we never wait on a transfer that is still in flight
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[nextPbo]);
+        nextPbo = (nextPbo + 1) % PBO_COUNT;
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+        void *mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        const void *source = (const void *)0;
+        if (mapped)
+        {
+            memcpy(mapped, image.pixels, size);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        }
+        else
+        {
+            // mapping failed, fall back to a plain client-memory upload
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            source = image.pixels;
+        }
+
+        GLint alignment;
+        glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, source);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        TextureMemoryStats &entry = stats[textureID];
+        int texelBytes = image.components == 3 ? 4 : image.components; // drivers store RGB8 padded to RGBA8
+        entry.uncompressedBytes = mipChainBytes(image.width, image.height, texelBytes);
+        entry.gpuBytes = entry.uncompressedBytes;
+        entry.bitsPerTexel = entry.uncompressedBitsPerTexel = texelBytes * 8.0f;
+        entry.format = "uncompressed";
+        entry.width = image.width;
+        entry.height = image.height;
+        entry.levelCount = MipLevelCount(image.width, image.height);
+        entry.baseLevel = 0;
+        entry.streamable = false;
+        return size;
+    }
+
+    static size_t mipChainBytes(int width, int height, int texelBytes)
+    {
+        size_t total = 0;
+        for (;;)
+        {
+            total += (size_t)width * height * texelBytes;
+            if (width == 1 && height == 1)
+                return total;
+            width = std::max(1, width / 2);
+            height = std::max(1, height / 2);
+        }
+    }
+
+    // streams a prebuilt compressed mip chain through one PBO and specifies every level from it.
+    size_t uploadCompressed(unsigned int textureID, const DecodedImage &image)
+    {
+        const CompressedTexture &blocks = image.blocks;
+        size_t size = blocks.data.size();
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[nextPbo]);
+        nextPbo = (nextPbo + 1) % PBO_COUNT;
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+        void *mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        const unsigned char *base = (const unsigned char *)0;
+        if (mapped)
+        {
+            memcpy(mapped, blocks.data.data(), size);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        }
+        else
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            base = blocks.data.data();
+        }
+
+        GLenum internalFormat = BlockFormatGL(blocks.format);
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        for (size_t level = 0; level < blocks.levels.size(); level++)
+        {
+            const CompressedLevel &l = blocks.levels[level];
+            glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)level, internalFormat, l.width, l.height, 0, (GLsizei)l.size, base + l.offset);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)blocks.levels.size() - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        TextureMemoryStats &entry = stats[textureID];
+        int texelBytes = image.components == 3 ? 4 : image.components;
+        entry.uncompressedBytes = mipChainBytes(blocks.levels[0].width, blocks.levels[0].height, texelBytes);
+        entry.gpuBytes = size;
+        entry.bitsPerTexel = BlockBytes(blocks.format) * 8.0f / 16.0f;
+        entry.uncompressedBitsPerTexel = texelBytes * 8.0f;
+        entry.format = BlockFormatName(blocks.format);
+        // image holds the size of the source, the chain may start further down
+        entry.width = image.width;
+        entry.height = image.height;
+        entry.levelCount = MipLevelCount(image.width, image.height);
+        entry.baseLevel = entry.levelCount - (unsigned int)blocks.levels.size();
+        entry.streamable = true;
+        return size;
+    }
+};
+#endif
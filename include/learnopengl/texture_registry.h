@@ -0,0 +1,122 @@
+#ifndef TEXTURE_REGISTRY_H
+#define TEXTURE_REGISTRY_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/texture_loader.h>
+#include <learnopengl/texture_residency.h>
+#include <learnopengl/vfs.h>
+
+#include <functional>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+using namespace std;
+
+// identifies one loaded texture: the same file loaded with different parameters is a different texture.
+struct TextureKey {
+    string path; // as the VirtualFileSystem normalizes it, see VirtualFileSystem::Normalize
+    bool gamma;
+    TextureUsage usage;
+
+    bool operator==(const TextureKey &other) const
+    {
+        return gamma == other.gamma && usage == other.usage && path == other.path;
+    }
+};
+
+struct TextureKeyHash {
+    size_t operator()(const TextureKey &key) const
+    {
+        return hash<string>()(key.path) ^ ((size_t)key.gamma << 1) ^ ((size_t)key.usage << 2);
+    }
+};
+
+// Process-wide, reference counted texture cache shared by every Model, so an image referenced by several
+// models (or several materials) is decoded and uploaded once. Must be used from the context thread.
+class TextureRegistry
+{
+public:
+    static TextureRegistry &Instance()
+    {
+        static TextureRegistry registry;
+        return registry;
+    }
+
+    // returns the texture for the given file and parameters, loading it on the first request. Textures start out
+    // with their preview levels, TextureResidency streams in what the screen needs.
+    unsigned int Acquire(const string &path, bool gamma = false, TextureUsage usage = TextureUsage::Color)
+    {
+        TextureKey key = {VirtualFileSystem::Normalize(path), gamma, usage};
+        auto it = entries.find(key);
+        if (it != entries.end())
+        {
+            hits++;
+            it->second.references++;
+            return it->second.id;
+        }
+        misses++;
+        Entry entry;
+        entry.id = TextureLoader::Instance().Load(key.path, usage, TEXTURE_PREVIEW_SIZE);
+        TextureResidency::Instance().Track(entry.id, key.path, usage);
+        entry.references = 1;
+        entries.emplace(key, entry);
+        keys.emplace(entry.id, key);
+        return entry.id;
+    }
+
+    // drops one reference; the texture is deleted once nobody uses it any more.
+    void Release(unsigned int id)
+    {
+        auto key = keys.find(id);
+        if (key == keys.end())
+            return;
+        auto it = entries.find(key->second);
+        if (--it->second.references > 0)
+            return;
+        TextureLoader::Instance().Forget(id);
+        TextureResidency::Instance().Untrack(id);
+        glDeleteTextures(1, &id);
+        entries.erase(it);
+        keys.erase(key);
+    }
+
+    // reloads every texture made from the given file in place, so the ids held by models stay valid.
+    // Returns the number of textures reloaded.
+    unsigned int Reload(const string &path)
+    {
+        string canonical = VirtualFileSystem::Normalize(path);
+        unsigned int reloaded = 0;
+        for (auto &entry : entries)
+            if (entry.first.path == canonical)
+            {
+                TextureLoader::Instance().Stream(entry.second.id, canonical, entry.first.usage,
+                                                 TextureResidency::Instance().ResidentSize(entry.second.id));
+                reloaded++;
+            }
+        return reloaded;
+    }
+
+    unsigned int Hits() const { return hits; }
+    unsigned int Misses() const { return misses; }
+    size_t Size() const { return entries.size(); }
+
+    void Report() const
+    {
+        cout << "TEXTURE::REGISTRY:: " << entries.size() << " textures, " << hits << " hits, " << misses << " misses" << endl;
+    }
+
+private:
+    struct Entry {
+        unsigned int id;
+        unsigned int references;
+    };
+
+    unordered_map<TextureKey, Entry, TextureKeyHash> entries;
+    unordered_map<unsigned int, TextureKey> keys;
+    unsigned int hits;
+    unsigned int misses;
+
+    TextureRegistry() : hits(0), misses(0) {}
+};
+#endif
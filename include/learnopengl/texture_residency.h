@@ -0,0 +1,258 @@
+#ifndef TEXTURE_RESIDENCY_H
+#define TEXTURE_RESIDENCY_H
+
+#include <learnopengl/texture_loader.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+const size_t TEXTURE_BUDGET_DEFAULT_BYTES = 256u << 20;
+// frames a texture may go without being drawn before it only keeps its preview levels
+const unsigned int TEXTURE_RESIDENCY_IDLE_FRAMES = 120;
+
+// residency state of one texture; levels count from the full resolution source (0) down.
+struct TextureResidencyInfo {
+    string path;
+    int width = 0;                   // full resolution
+    int height = 0;
+    unsigned int levelCount = 0;     // levels of the full chain
+    unsigned int residentLevel = 0;  // finest level in VRAM
+    unsigned int requestedLevel = 0; // finest level the meshes using the texture need on screen
+    unsigned int targetLevel = 0;    // requested level once the budget is enforced
+    size_t residentBytes = 0;
+    bool streaming = false;          // a change of the resident levels is in flight
+    bool streamable = false;         // compressed textures only: uncompressed ones stay as loaded
+};
+
+// Keeps texture memory within a VRAM budget. Draws report for every texture how many texture coordinate units
+// one screen pixel covers (Request), which gives the finest mip level that is actually visible. Once per frame
+// Update() turns those into target levels, coarsening the least recently drawn and then the largest textures
+// until the budget is met, and has the TextureLoader stream finer levels in from the compressed texture cache
+// or respecify textures with fewer levels to evict them. Must be used from the context thread.
+class TextureResidency
+{
+public:
+    static TextureResidency &Instance()
+    {
+        static TextureResidency residency;
+        return residency;
+    }
+
+    size_t budgetBytes;
+
+    // starts managing a texture; it is loaded with its preview levels only and refined once it is drawn.
+    void Track(unsigned int textureID, const string &path, TextureUsage usage)
+    {
+        Entry &entry = entries[textureID];
+        entry.info.path = path;
+        entry.usage = usage;
+        entry.lastRequestFrame = frame;
+        entry.frameUvPerPixel = -1.0f;
+    }
+
+    void Untrack(unsigned int textureID)
+    {
+        entries.erase(textureID);
+    }
+
+    // the texture is drawn this frame with uvPerPixel texture coordinate units per screen pixel; 0 asks for
+    // the full resolution.
+    void Request(unsigned int textureID, float uvPerPixel)
+    {
+        auto it = entries.find(textureID);
+        if (it == entries.end())
+            return;
+        Entry &entry = it->second;
+        if (entry.frameUvPerPixel < 0.0f || uvPerPixel < entry.frameUvPerPixel)
+            entry.frameUvPerPixel = uvPerPixel;
+    }
+
+    // turns this frame's requests into target levels and starts streaming towards them. Call once per frame,
+    // after everything has been drawn.
+    void Update()
+    {
+        frame++;
+        size_t targetBytes = 0;
+        for (auto &item : entries)
+        {
+            Entry &entry = item.second;
+            TextureResidencyInfo &info = entry.info;
+            const TextureMemoryStats *stats = TextureLoader::Instance().Stats(item.first);
+            if (info.streaming && !TextureLoader::Instance().Pending(item.first))
+                info.streaming = false;
+            if (!stats)
+            {
+                entry.frameUvPerPixel = -1.0f; // not loaded yet, requests are repeated every frame
+                continue;
+            }
+            info.width = stats->width;
+            info.height = stats->height;
+            info.levelCount = stats->levelCount;
+            info.residentLevel = stats->baseLevel;
+            info.residentBytes = stats->gpuBytes;
+            info.streamable = stats->streamable;
+            entry.bitsPerTexel = stats->bitsPerTexel;
+            if (entry.frameUvPerPixel >= 0.0f)
+            {
+                info.requestedLevel = levelFor(info, entry.frameUvPerPixel);
+                entry.lastRequestFrame = frame;
+                entry.requested = true;
+            }
+            else if (!entry.requested || frame - entry.lastRequestFrame > TEXTURE_RESIDENCY_IDLE_FRAMES)
+                info.requestedLevel = previewLevel(info);
+            entry.frameUvPerPixel = -1.0f;
+            info.targetLevel = info.streamable ? info.requestedLevel : info.residentLevel;
+            targetBytes += chainBytes(entry, info.targetLevel);
+        }
+        // over budget: drop the finest level of the texture drawn longest ago, the largest one among equals
+        while (targetBytes > budgetBytes)
+        {
+            Entry *victim = nullptr;
+            for (auto &item : entries)
+            {
+                Entry &entry = item.second;
+                if (!entry.info.streamable || entry.info.levelCount == 0 || entry.info.targetLevel >= previewLevel(entry.info))
+                    continue;
+                if (!victim || entry.lastRequestFrame < victim->lastRequestFrame
+                    || (entry.lastRequestFrame == victim->lastRequestFrame
+                        && levelBytes(entry, entry.info.targetLevel) > levelBytes(*victim, victim->info.targetLevel)))
+                    victim = &entry;
+            }
+            if (!victim)
+                break; // everything is down to its preview
+            targetBytes -= levelBytes(*victim, victim->info.targetLevel);
+            victim->info.targetLevel++;
+        }
+        bool overBudget = ResidentBytes() > budgetBytes;
+        for (auto &item : entries)
+        {
+            TextureResidencyInfo &info = item.second.info;
+            if (!info.streamable || info.streaming || info.levelCount == 0 || info.targetLevel == info.residentLevel)
+                continue;
+            // finer levels are streamed in right away, resident ones are only given up when memory is needed
+            // or the texture is no longer drawn, so moving the camera back and forth does not thrash
+            bool idle = frame - item.second.lastRequestFrame > TEXTURE_RESIDENCY_IDLE_FRAMES;
+            if (info.targetLevel > info.residentLevel && !overBudget && !idle)
+                continue;
+            TextureLoader::Instance().Stream(item.first, info.path, item.second.usage, levelSize(info, info.targetLevel));
+            info.streaming = true;
+        }
+    }
+
+    // no level changes in flight or wanted, and every loaded texture has been through Update() once.
+    bool Idle() const
+    {
+        for (const auto &item : entries)
+        {
+            const TextureResidencyInfo &info = item.second.info;
+            // textures that failed to load never get there
+            if (info.levelCount == 0 && (TextureLoader::Instance().Pending(item.first) || TextureLoader::Instance().Stats(item.first)))
+                return false;
+            if (info.streaming || (info.streamable && info.targetLevel < info.residentLevel))
+                return false;
+        }
+        return true;
+    }
+
+    // size of the finest resident level, 0 while the texture has not been loaded yet.
+    int ResidentSize(unsigned int textureID) const
+    {
+        const TextureResidencyInfo *info = Info(textureID);
+        return info && info->levelCount > 0 ? levelSize(*info, info->residentLevel) : 0;
+    }
+
+    size_t ResidentBytes() const
+    {
+        size_t total = 0;
+        for (const auto &item : entries)
+            total += item.second.info.residentBytes;
+        return total;
+    }
+
+    // residency state of a texture, nullptr for textures that are not tracked.
+    const TextureResidencyInfo *Info(unsigned int textureID) const
+    {
+        auto it = entries.find(textureID);
+        return it != entries.end() ? &it->second.info : nullptr;
+    }
+
+    void Report() const
+    {
+        for (const auto &item : entries)
+        {
+            const TextureResidencyInfo &info = item.second.info;
+            cout << "TEXTURE::RESIDENCY::   " << info.path << " " << info.width << "x" << info.height << ": resident level "
+                 << info.residentLevel << " (" << levelSize(info, info.residentLevel) << " px), requested " << info.requestedLevel
+                 << ", target " << info.targetLevel << ", " << info.residentBytes / 1024.0 / 1024.0 << " MB"
+                 << (info.streaming ? ", streaming" : "") << (info.streamable ? "" : ", not streamable") << endl;
+        }
+        cout << "TEXTURE::RESIDENCY:: " << entries.size() << " textures, " << ResidentBytes() / 1024.0 / 1024.0 << " MB resident of a "
+             << budgetBytes / 1024.0 / 1024.0 << " MB budget" << endl;
+    }
+
+private:
+    struct Entry {
+        TextureResidencyInfo info;
+        TextureUsage usage;
+        float frameUvPerPixel;  // smallest request this frame, negative without one
+        uint64_t lastRequestFrame;
+        bool requested = false; // drawn at least once
+        float bitsPerTexel = 0.0f;
+    };
+
+    unordered_map<unsigned int, Entry> entries;
+    uint64_t frame;
+
+    TextureResidency() : budgetBytes(TEXTURE_BUDGET_DEFAULT_BYTES), frame(0) {}
+
+    // finest level whose texels are no smaller than a screen pixel
+    static unsigned int levelFor(const TextureResidencyInfo &info, float uvPerPixel)
+    {
+        float texelsPerPixel = std::max(info.width, info.height) * uvPerPixel;
+        unsigned int level = texelsPerPixel > 1.0f ? (unsigned int)floorf(log2f(texelsPerPixel)) : 0;
+        return std::min(level, info.levelCount - 1);
+    }
+
+    // coarsest level kept at all times, the one the texture was first loaded with
+    static unsigned int previewLevel(const TextureResidencyInfo &info)
+    {
+        unsigned int level = 0;
+        while (level + 1 < info.levelCount && levelSize(info, level) > TEXTURE_PREVIEW_SIZE)
+            level++;
+        return level;
+    }
+
+    static int levelSize(const TextureResidencyInfo &info, unsigned int level)
+    {
+        return std::max(1, std::max(info.width, info.height) >> level);
+    }
+
+    static size_t levelBytes(const Entry &entry, unsigned int level)
+    {
+        // compressed levels are stored in whole 4x4 blocks
+        size_t width = std::max(1, entry.info.width >> level), height = std::max(1, entry.info.height >> level);
+        if (entry.info.streamable)
+        {
+            width = (width + 3) / 4 * 4;
+            height = (height + 3) / 4 * 4;
+        }
+        return (size_t)(width * height * entry.bitsPerTexel / 8.0f);
+    }
+
+    static size_t chainBytes(const Entry &entry, unsigned int level)
+    {
+        if (!entry.info.streamable)
+            return entry.info.residentBytes;
+        size_t total = 0;
+        for (unsigned int l = level; l < entry.info.levelCount; l++)
+            total += levelBytes(entry, l);
+        return total;
+    }
+};
+#endif
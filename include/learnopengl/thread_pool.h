@@ -0,0 +1,137 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <learnopengl/trace.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool of worker threads for CPU-only loading work (file parsing, Assimp import, image decoding).
+// Tasks must never touch OpenGL: the context is only current on the main thread.
+class ThreadPool
+{
+public:
+    // workers are named "<name> <index>" in traces (see trace.h).
+    explicit ThreadPool(unsigned int threadCount = std::thread::hardware_concurrency(), const std::string &name = "worker")
+        : stopping(false)
+    {
+        if (threadCount == 0)
+            threadCount = 1;
+        for (unsigned int i = 0; i < threadCount; i++)
+            workers.emplace_back([this, name, i] {
+                Tracer::Instance().NameThread(name + " " + std::to_string(i));
+                workerLoop();
+            });
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeup.notify_all();
+        for (std::thread &worker : workers)
+            worker.join();
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // queues a task and returns a future for its result.
+    template <typename F>
+    auto Submit(F task) -> std::future<decltype(task())>
+    {
+        typedef decltype(task()) Result;
+        std::shared_ptr<std::packaged_task<Result()>> packaged = std::make_shared<std::packaged_task<Result()>>(std::move(task));
+        std::future<Result> result = packaged->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push([packaged] { (*packaged)(); });
+        }
+        wakeup.notify_one();
+        return result;
+    }
+
+    // runs body(i) for every i in [0, count) on the pool and returns once all calls have finished. The calling
+    // thread works through items too, so this is safe to use from inside a pool task.
+    template <typename F>
+    void ParallelFor(size_t count, F body)
+    {
+        struct State {
+            std::atomic<size_t> next;
+            std::atomic<size_t> done;
+            std::mutex mutex;
+            std::condition_variable finished;
+        };
+        std::shared_ptr<State> state = std::make_shared<State>();
+        state->next = 0;
+        state->done = 0;
+        // helpers that only start after all items were taken return without touching body
+        std::function<void()> run = [state, count, &body] {
+            for (size_t i = state->next++; i < count; i = state->next++)
+            {
+                body(i);
+                if (++state->done == count)
+                {
+                    std::lock_guard<std::mutex> lock(state->mutex);
+                    state->finished.notify_all();
+                }
+            }
+        };
+        size_t helpers = std::min(count, workers.size()) > 0 ? std::min(count, workers.size()) - 1 : 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (size_t i = 0; i < helpers; i++)
+                tasks.push(run);
+        }
+        for (size_t i = 0; i < helpers; i++)
+            wakeup.notify_one();
+        run();
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->finished.wait(lock, [&state, count] { return state->done == count; });
+    }
+
+    unsigned int Size() const { return (unsigned int)workers.size(); }
+
+    // shared pool used by the asset loaders, sized to the number of hardware threads.
+    static ThreadPool &Loaders()
+    {
+        static ThreadPool pool(std::thread::hardware_concurrency(), "loader");
+        return pool;
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    bool stopping;
+
+    void workerLoop()
+    {
+        for (;;)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeup.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (stopping && tasks.empty())
+                    return;
+                task = std::move(tasks.front());
+                tasks.pop();
+            }
+            task();
+        }
+    }
+};
+#endif
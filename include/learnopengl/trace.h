@@ -0,0 +1,154 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Records nested phases (TraceScope) with the thread they ran on and writes them as Chrome trace event JSON,
+// which chrome://tracing and https://ui.perfetto.dev open. Recording is off until enabled is set; disabled
+// scopes cost a branch. Safe to use from any thread.
+class Tracer
+{
+public:
+    static Tracer &Instance()
+    {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    std::atomic<bool> enabled;
+
+    // microseconds since the tracer was created, the time base of all events
+    int64_t Now() const
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    // records a finished phase of the calling thread; detail (a file name, say) is shown with the event.
+    void Record(const char *name, const std::string &detail, int64_t start, int64_t end)
+    {
+        Event event = {name, detail, start, end - start, ThreadId()};
+        std::lock_guard<std::mutex> lock(mutex);
+        events.push_back(std::move(event));
+    }
+
+    // names the calling thread in the trace.
+    void NameThread(const std::string &name)
+    {
+        unsigned int id = ThreadId();
+        std::lock_guard<std::mutex> lock(mutex);
+        threadNames.push_back(std::make_pair(id, name));
+    }
+
+    // small sequential id of the calling thread, in the order threads first asked for it
+    static unsigned int ThreadId()
+    {
+        static std::atomic<unsigned int> nextId(1);
+        thread_local unsigned int id = nextId++;
+        return id;
+    }
+
+    bool Write(const std::string &path) const
+    {
+        std::ofstream out(path, std::ios::trunc);
+        if (!out)
+        {
+            std::cout << "ERROR::TRACE:: could not write " << path << std::endl;
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        bool first = true;
+        for (const auto &thread : threadNames)
+        {
+            out << (first ? "" : ",\n") << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << thread.first
+                << ",\"args\":{\"name\":\"" << escape(thread.second) << "\"}}";
+            first = false;
+        }
+        for (const Event &event : events)
+        {
+            out << (first ? "" : ",\n") << "{\"ph\":\"X\",\"name\":\"" << escape(event.name) << "\",\"pid\":1,\"tid\":" << event.thread
+                << ",\"ts\":" << event.start << ",\"dur\":" << event.duration;
+            if (!event.detail.empty())
+                out << ",\"args\":{\"detail\":\"" << escape(event.detail) << "\"}";
+            out << "}";
+            first = false;
+        }
+        out << "\n]}\n";
+        std::cout << "TRACE:: " << events.size() << " events written to " << path << std::endl;
+        return true;
+    }
+
+private:
+    struct Event {
+        const char *name; // string literal
+        std::string detail;
+        int64_t start;
+        int64_t duration;
+        unsigned int thread;
+    };
+
+    std::chrono::steady_clock::time_point epoch;
+    mutable std::mutex mutex;
+    std::vector<Event> events;
+    std::vector<std::pair<unsigned int, std::string>> threadNames;
+
+    Tracer() : enabled(false), epoch(std::chrono::steady_clock::now()) {}
+
+    static std::string escape(const std::string &text)
+    {
+        std::string escaped;
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                escaped += '\\';
+            if ((unsigned char)c < 0x20)
+            {
+                char code[8];
+                snprintf(code, sizeof(code), "\\u%04x", c);
+                escaped += code;
+                continue;
+            }
+            escaped += c;
+        }
+        return escaped;
+    }
+};
+
+// records the lifetime of the scope as a phase of the calling thread. name must be a string literal.
+class TraceScope
+{
+public:
+    explicit TraceScope(const char *name, const std::string &detail = std::string())
+        : name(name), start(Tracer::Instance().enabled ? Tracer::Instance().Now() : -1)
+    {
+        if (start >= 0)
+            this->detail = detail;
+    }
+
+    ~TraceScope() { End(); }
+
+    // ends the phase before the scope does, for phases that declare variables used after them.
+    void End()
+    {
+        if (start >= 0)
+            Tracer::Instance().Record(name, detail, start, Tracer::Instance().Now());
+        start = -1;
+    }
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+    const char *name;
+    std::string detail;
+    int64_t start;
+};
+#endif
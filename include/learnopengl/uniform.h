@@ -0,0 +1,159 @@
+#ifndef UNIFORM_H
+#define UNIFORM_H
+
+#include <glad/glad.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Uniform names are interned to small ids once, so a handle is an int and looking it up in a program is an
+// array index. Handles name a uniform, not a location in one program: the same handle works with every
+// program, including the ones hot reloading swaps in.
+class UniformNames
+{
+public:
+    static unsigned int Id(const std::string &name)
+    {
+        UniformNames &names = instance();
+        std::lock_guard<std::mutex> lock(names.mutex);
+        auto it = names.ids.find(name);
+        if (it != names.ids.end())
+            return it->second;
+        names.names.push_back(name);
+        return names.ids[name] = (unsigned int)names.names.size() - 1;
+    }
+
+    static std::string Name(unsigned int id)
+    {
+        UniformNames &names = instance();
+        std::lock_guard<std::mutex> lock(names.mutex);
+        return id < names.names.size() ? names.names[id] : std::string();
+    }
+
+private:
+    std::mutex mutex;
+    std::unordered_map<std::string, unsigned int> ids;
+    std::vector<std::string> names;
+
+    static UniformNames &instance()
+    {
+        static UniformNames names;
+        return names;
+    }
+};
+
+// typed handle of a uniform, see Shader::set. Create handles once (they cost a hash lookup under a lock) and
+// keep them; setting through a handle allocates nothing and makes no driver lookup.
+template <typename T>
+struct Uniform {
+    static const unsigned int NONE = ~0u;
+    unsigned int id;
+
+    Uniform() : id(NONE) {}
+    explicit Uniform(const std::string &name) : id(UniformNames::Id(name)) {}
+};
+
+// Locations of the active uniforms of one linked program, resolved in one pass over GL_ACTIVE_UNIFORMS the
+// first time the program sets a uniform. Array elements are listed individually ("depthMaps[1]") and under the
+// bare array name, as glGetUniformLocation accepts them. Names the program does not use resolve to -1, which
+// glUniform* ignores. Main thread only, like the glUniform* calls these locations feed.
+class ProgramUniforms
+{
+public:
+    static ProgramUniforms &Of(unsigned int program)
+    {
+        Registry &registry = instance();
+        if (registry.lastProgram == program && registry.last)
+            return *registry.last;
+        std::unique_ptr<ProgramUniforms> &uniforms = registry.programs[program];
+        if (!uniforms)
+            uniforms.reset(new ProgramUniforms(program));
+        registry.lastProgram = program;
+        registry.last = uniforms.get();
+        return *uniforms;
+    }
+
+    // drops the table of a program about to be deleted; GL reuses program names.
+    static void Forget(unsigned int program)
+    {
+        Registry &registry = instance();
+        registry.programs.erase(program);
+        if (registry.lastProgram == program)
+            registry.last = nullptr;
+    }
+
+    GLint Location(const std::string &name) const
+    {
+        auto it = locations.find(name);
+        return it != locations.end() ? it->second : -1;
+    }
+
+    template <typename T>
+    GLint Location(const Uniform<T> &uniform)
+    {
+        if (uniform.id == Uniform<T>::NONE)
+            return -1;
+        if (uniform.id >= byId.size())
+            byId.resize(uniform.id + 1, (GLint)UNRESOLVED);
+        GLint &location = byId[uniform.id];
+        if (location == UNRESOLVED)
+            location = Location(UniformNames::Name(uniform.id));
+        return location;
+    }
+
+private:
+    static const GLint UNRESOLVED = -2;
+
+    struct Registry {
+        std::unordered_map<unsigned int, std::unique_ptr<ProgramUniforms>> programs;
+        unsigned int lastProgram = 0;
+        ProgramUniforms *last = nullptr;
+    };
+
+    std::unordered_map<std::string, GLint> locations;
+    std::vector<GLint> byId; // by UniformNames id
+
+    explicit ProgramUniforms(unsigned int program)
+    {
+        if (!program)
+            return;
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<GLchar> buffer((size_t)maxLength + 1);
+        for (GLint i = 0; i < count; i++)
+        {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(program, (GLuint)i, (GLsizei)buffer.size(), &length, &size, &type, buffer.data());
+            std::string name(buffer.data(), (size_t)length);
+            GLint location = glGetUniformLocation(program, name.c_str());
+            // members of uniform blocks have no location
+            if (location < 0)
+                continue;
+            locations[name] = location;
+            // arrays of basic types are reported once, as "name[0]" with their element count
+            if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+            {
+                std::string base = name.substr(0, name.size() - 3);
+                locations[base] = location;
+                for (GLint element = 1; element < size; element++)
+                {
+                    std::string elementName = base + '[' + std::to_string(element) + ']';
+                    locations[elementName] = glGetUniformLocation(program, elementName.c_str());
+                }
+            }
+        }
+    }
+
+    static Registry &instance()
+    {
+        static Registry registry;
+        return registry;
+    }
+};
+#endif
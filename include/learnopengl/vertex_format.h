@@ -0,0 +1,297 @@
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+using namespace std;
+
+// GPU vertex layouts and the quantization that produces the compact one.
+//
+// VertexLayout::Float uploads Vertex as is (56 bytes). VertexLayout::Quantized uploads PackedVertex (20 bytes):
+//   position  3 x unorm16 over the mesh bounds; the shader applies positionScale/positionOffset
+//   normal    octahedral encoding in 2 x snorm16; the shader decodes it when quantizedNormals is set
+//   texcoords 2 x half float
+//   tangent   xyz in snorm 10:10:10 plus the bitangent's handedness in the 2 bit w, bitangent = cross(N, T) * w
+// Attribute locations are the same for both layouts, so shaders only differ in how they interpret them.
+// Meshes whose quantization error exceeds the tolerances below are uploaded with the float layout instead.
+
+struct Vertex {
+    // position
+    glm::vec3 Position;
+    // normal
+    glm::vec3 Normal;
+    // texCoords
+    glm::vec2 TexCoords;
+    // tangent
+    glm::vec3 Tangent;
+    // bitangent
+    glm::vec3 Bitangent;
+};
+
+enum class VertexLayout { Float, Quantized };
+
+struct PackedVertex {
+    uint16_t Position[4]; // xyz, w is padding
+    int16_t  Normal[2];
+    uint16_t TexCoords[2];
+    uint32_t Tangent;
+};
+
+// one glVertexAttribPointer call
+struct VertexAttribute {
+    GLuint location;
+    GLint components;
+    GLenum type;
+    GLboolean normalized;
+    size_t offset;
+};
+
+struct VertexFormat {
+    GLsizei stride;
+    vector<VertexAttribute> attributes;
+
+    static VertexFormat Get(VertexLayout layout)
+    {
+        VertexFormat format;
+        if (layout == VertexLayout::Quantized)
+        {
+            format.stride = sizeof(PackedVertex);
+            format.attributes = {
+                {0, 3, GL_UNSIGNED_SHORT, GL_TRUE, offsetof(PackedVertex, Position)},
+                {1, 2, GL_SHORT, GL_TRUE, offsetof(PackedVertex, Normal)},
+                {2, 2, GL_HALF_FLOAT, GL_FALSE, offsetof(PackedVertex, TexCoords)},
+                {3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, offsetof(PackedVertex, Tangent)},
+            };
+        }
+        else
+        {
+            format.stride = sizeof(Vertex);
+            format.attributes = {
+                {0, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, Position)},
+                {1, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, Normal)},
+                {2, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, TexCoords)},
+                {3, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, Tangent)},
+                {4, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, Bitangent)},
+            };
+        }
+        return format;
+    }
+
+    // position-only stream for depth passes: the position attribute alone, tightly packed.
+    static VertexFormat Positions(VertexLayout layout)
+    {
+        VertexFormat format;
+        if (layout == VertexLayout::Quantized)
+        {
+            format.stride = sizeof(PackedVertex::Position);
+            format.attributes = {{0, 3, GL_UNSIGNED_SHORT, GL_TRUE, 0}};
+        }
+        else
+        {
+            format.stride = sizeof(glm::vec3);
+            format.attributes = {{0, 3, GL_FLOAT, GL_FALSE, 0}};
+        }
+        return format;
+    }
+
+    // sets up the attribute pointers of the bound VAO for the buffer bound to GL_ARRAY_BUFFER.
+    void Apply() const
+    {
+        for (const VertexAttribute &attribute : attributes)
+        {
+            glEnableVertexAttribArray(attribute.location);
+            glVertexAttribPointer(attribute.location, attribute.components, attribute.type, attribute.normalized, stride, (void*)attribute.offset);
+        }
+    }
+};
+
+// IEEE 754 binary16 conversion with round to nearest even; out of range values saturate to infinity.
+inline uint16_t FloatToHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, 4);
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t magnitude = bits & 0x7FFFFFFF;
+    if (magnitude >= 0x7F800000) // inf or nan
+        return (uint16_t)(sign | 0x7C00 | (magnitude > 0x7F800000 ? 0x200 : 0));
+    if (magnitude >= 0x477FF000) // rounds to above the largest half
+        return (uint16_t)(sign | 0x7C00);
+    if (magnitude < 0x38800000) // subnormal half or zero
+    {
+        float absolute;
+        memcpy(&absolute, &magnitude, 4);
+        return (uint16_t)(sign | (uint32_t)lrintf(absolute * 16777216.0f)); // multiples of 2^-24
+    }
+    uint32_t rounded = magnitude + 0xFFF + ((magnitude >> 13) & 1);
+    return (uint16_t)(sign | ((rounded - 0x38000000) >> 13));
+}
+
+inline float HalfToFloat(uint16_t half)
+{
+    uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x3FF;
+    if (exponent == 0)
+    {
+        float value = mantissa / 16777216.0f;
+        return sign ? -value : value;
+    }
+    uint32_t bits = sign | (exponent == 31 ? 0x7F800000 | (mantissa << 13) : ((exponent + 112) << 23) | (mantissa << 13));
+    float value;
+    memcpy(&value, &bits, 4);
+    return value;
+}
+
+inline int16_t quantizeSnorm16(float value)
+{
+    return (int16_t)lrintf(std::max(-1.0f, std::min(1.0f, value)) * 32767.0f);
+}
+
+// octahedral normal encoding: project onto the octahedron |x|+|y|+|z| = 1 and fold the lower half over the diagonals.
+inline void EncodeOctahedral(const glm::vec3 &normal, int16_t encoded[2])
+{
+    float sum = fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z);
+    if (sum <= 0.0f)
+    {
+        encoded[0] = encoded[1] = 0; // decodes to +z
+        return;
+    }
+    float x = normal.x / sum, y = normal.y / sum;
+    if (normal.z < 0.0f)
+    {
+        float fx = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float fy = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = fx;
+        y = fy;
+    }
+    encoded[0] = quantizeSnorm16(x);
+    encoded[1] = quantizeSnorm16(y);
+}
+
+// CPU mirror of octDecode in the vertex shaders.
+inline glm::vec3 DecodeOctahedral(const int16_t encoded[2])
+{
+    float x = std::max(encoded[0] / 32767.0f, -1.0f), y = std::max(encoded[1] / 32767.0f, -1.0f);
+    float z = 1.0f - fabsf(x) - fabsf(y);
+    float t = std::max(-z, 0.0f);
+    x += x >= 0.0f ? -t : t;
+    y += y >= 0.0f ? -t : t;
+    float length = sqrtf(x * x + y * y + z * z);
+    return glm::vec3(x / length, y / length, z / length);
+}
+
+inline uint32_t packSnorm10(float value)
+{
+    return (uint32_t)lrintf(std::max(-1.0f, std::min(1.0f, value)) * 511.0f) & 0x3FF;
+}
+
+// uniform position quantization grid of a mesh: position = quantized / 65535 * scale + offset.
+// A single scale for all axes keeps the transform conformal, so normals need no correction.
+struct PositionQuantization {
+    glm::vec3 offset;
+    float scale;
+};
+
+inline PositionQuantization ComputePositionQuantization(const Vertex *vertices, size_t vertexCount)
+{
+    PositionQuantization quantization = {glm::vec3(0.0f), 1.0f};
+    if (vertexCount == 0)
+        return quantization;
+    glm::vec3 lo = vertices[0].Position, hi = vertices[0].Position;
+    for (size_t i = 1; i < vertexCount; i++)
+    {
+        const glm::vec3 &p = vertices[i].Position;
+        lo = glm::vec3(std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z));
+        hi = glm::vec3(std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z));
+    }
+    quantization.offset = lo;
+    quantization.scale = std::max(hi.x - lo.x, std::max(hi.y - lo.y, hi.z - lo.z));
+    if (quantization.scale <= 0.0f)
+        quantization.scale = 1.0f;
+    return quantization;
+}
+
+inline PackedVertex PackVertex(const Vertex &vertex, const PositionQuantization &quantization)
+{
+    PackedVertex packed;
+    for (int c = 0; c < 3; c++)
+    {
+        float normalized = (vertex.Position[c] - quantization.offset[c]) / quantization.scale;
+        packed.Position[c] = (uint16_t)lrintf(std::max(0.0f, std::min(1.0f, normalized)) * 65535.0f);
+    }
+    packed.Position[3] = 0;
+    EncodeOctahedral(vertex.Normal, packed.Normal);
+    packed.TexCoords[0] = FloatToHalf(vertex.TexCoords.x);
+    packed.TexCoords[1] = FloatToHalf(vertex.TexCoords.y);
+    // handedness of the tangent frame; the bitangent is rebuilt from it
+    float handedness = glm::dot(glm::cross(vertex.Normal, vertex.Tangent), vertex.Bitangent) < 0.0f ? -1.0f : 1.0f;
+    packed.Tangent = packSnorm10(vertex.Tangent.x) | (packSnorm10(vertex.Tangent.y) << 10) | (packSnorm10(vertex.Tangent.z) << 20)
+                     | ((handedness < 0.0f ? 3u : 1u) << 30);
+    return packed;
+}
+
+inline vector<PackedVertex> PackVertices(const Vertex *vertices, size_t vertexCount, const PositionQuantization &quantization)
+{
+    vector<PackedVertex> packed(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++)
+        packed[i] = PackVertex(vertices[i], quantization);
+    return packed;
+}
+
+// tolerances under which the quantized layout renders indistinguishably from the float one
+const float QUANTIZATION_POSITION_TOLERANCE = 1e-4f;        // fraction of the mesh extent
+const float QUANTIZATION_NORMAL_TOLERANCE = 0.1f;           // degrees
+const float QUANTIZATION_TEXCOORD_TOLERANCE = 1.0f / 4096;  // half a texel of a 2048 texture
+
+// largest differences between what the shaders see with the quantized and with the float layout.
+struct QuantizationError {
+    float position = 0.0f;      // fraction of the mesh extent
+    float normalDegrees = 0.0f;
+    float texCoords = 0.0f;
+
+    bool withinTolerance() const
+    {
+        return position <= QUANTIZATION_POSITION_TOLERANCE && normalDegrees <= QUANTIZATION_NORMAL_TOLERANCE
+               && texCoords <= QUANTIZATION_TEXCOORD_TOLERANCE;
+    }
+
+    void merge(const QuantizationError &other)
+    {
+        position = std::max(position, other.position);
+        normalDegrees = std::max(normalDegrees, other.normalDegrees);
+        texCoords = std::max(texCoords, other.texCoords);
+    }
+};
+
+inline QuantizationError MeasureQuantizationError(const Vertex *vertices, const PackedVertex *packed, size_t vertexCount,
+                                                   const PositionQuantization &quantization)
+{
+    QuantizationError error;
+    for (size_t i = 0; i < vertexCount; i++)
+    {
+        const Vertex &v = vertices[i];
+        const PackedVertex &p = packed[i];
+        for (int c = 0; c < 3; c++)
+            error.position = std::max(error.position, fabsf(p.Position[c] / 65535.0f * quantization.scale + quantization.offset[c] - v.Position[c])
+                                                      / quantization.scale);
+        float length = sqrtf(v.Normal.x * v.Normal.x + v.Normal.y * v.Normal.y + v.Normal.z * v.Normal.z);
+        if (length > 0.0f)
+        {
+            glm::vec3 n = DecodeOctahedral(p.Normal);
+            float cosine = (n.x * v.Normal.x + n.y * v.Normal.y + n.z * v.Normal.z) / length;
+            error.normalDegrees = std::max(error.normalDegrees, acosf(std::max(-1.0f, std::min(1.0f, cosine))) * 57.2957795f);
+        }
+        error.texCoords = std::max(error.texCoords, std::max(fabsf(HalfToFloat(p.TexCoords[0]) - v.TexCoords.x),
+                                                             fabsf(HalfToFloat(p.TexCoords[1]) - v.TexCoords.y)));
+    }
+    return error;
+}
+#endif
@@ -0,0 +1,244 @@
+#ifndef VFS_H
+#define VFS_H
+
+#include <learnopengl/asset_cache.h>
+#include <learnopengl/asset_pack.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Contents of one file opened through the VirtualFileSystem: a mapping of a loose file, a view into a mounted
+// pack, or the decompressed copy of a packed entry. Move-only; the data stays valid while the object lives.
+class VfsFile
+{
+public:
+    VfsFile() : bytes(nullptr), length(0), mapping(nullptr), packed(false) {}
+    ~VfsFile() { release(); }
+    VfsFile(const VfsFile &) = delete;
+    VfsFile &operator=(const VfsFile &) = delete;
+    VfsFile(VfsFile &&other) : VfsFile() { *this = std::move(other); }
+    VfsFile &operator=(VfsFile &&other)
+    {
+        if (this != &other)
+        {
+            release();
+            bytes = other.bytes;
+            length = other.length;
+            mapping = other.mapping;
+            buffer = std::move(other.buffer);
+            packed = other.packed;
+            other.bytes = nullptr;
+            other.length = 0;
+            other.mapping = nullptr;
+        }
+        return *this;
+    }
+
+    explicit operator bool() const { return bytes != nullptr; }
+    const char *data() const { return bytes; }
+    size_t size() const { return length; }
+    bool fromPack() const { return packed; }
+
+private:
+    friend class VirtualFileSystem;
+
+    const char *bytes;
+    size_t length;
+    void *mapping;              // loose files
+    unique_ptr<char[]> buffer;  // compressed pack entries
+    bool packed;
+
+    void release()
+    {
+        if (mapping)
+            munmap(mapping, length);
+        mapping = nullptr;
+        buffer.reset();
+        bytes = nullptr;
+        length = 0;
+    }
+};
+
+// Resolves asset paths to their contents. Assets come from mounted packs (see asset_pack.h) and, with
+// looseFiles enabled, from files on disk, which take precedence so that assets can be edited (and hot
+// reloaded) during development without rebuilding the pack. Paths are normalized, so "a/./b", "a/x/../b" and
+// "a\\b" all name the same file. Mount packs before anything is loaded; lookups are safe from any thread.
+class VirtualFileSystem
+{
+public:
+    static VirtualFileSystem &Instance()
+    {
+        static VirtualFileSystem vfs;
+        return vfs;
+    }
+
+    bool looseFiles;
+
+    // maps a pack; packs mounted later take precedence over earlier ones.
+    bool Mount(const string &packPath)
+    {
+        unique_ptr<AssetPack> pack(new AssetPack());
+        if (!pack->open(packPath))
+            return false;
+        cout << "VFS:: mounted " << packPath << " (" << pack->entryCount() << " files)" << endl;
+        packs.insert(packs.begin(), std::move(pack));
+        return true;
+    }
+
+    VfsFile Open(const string &path) const
+    {
+        VfsFile file;
+        string normalized = Normalize(path);
+        if (looseFiles && openLoose(normalized, file))
+            return file;
+        const AssetPack *pack;
+        const AssetPackEntry *entry = find(normalized, pack);
+        if (!entry)
+            return file;
+        file.packed = true;
+        file.length = (size_t)entry->size;
+        if (entry->compression == AssetPackCompression::None)
+        {
+            file.bytes = pack->contents(*entry);
+            return file;
+        }
+        file.buffer.reset(new char[file.length + 1]);
+        if (!LzDecompress((const unsigned char *)pack->contents(*entry), (size_t)entry->storedSize, (unsigned char *)file.buffer.get(),
+                          file.length))
+        {
+            cout << "ERROR::VFS:: " << normalized << " is corrupt in its pack" << endl;
+            return VfsFile();
+        }
+        file.bytes = file.buffer.get();
+        return file;
+    }
+
+    bool Read(const string &path, string &contents) const
+    {
+        VfsFile file = Open(path);
+        if (!file)
+            return false;
+        contents.assign(file.data(), file.size());
+        return true;
+    }
+
+    bool Exists(const string &path) const
+    {
+        string normalized = Normalize(path);
+        struct stat info;
+        const AssetPack *pack;
+        return (looseFiles && stat(normalized.c_str(), &info) == 0 && S_ISREG(info.st_mode)) || find(normalized, pack);
+    }
+
+    // modification time and size of the file a path resolves to, for invalidating the asset caches. Packed
+    // entries report the source file they were built from.
+    bool Stat(const string &path, int64_t &mtime, uint64_t &size) const
+    {
+        string normalized = Normalize(path);
+        if (looseFiles && AssetCacheStat(normalized, mtime, size))
+            return true;
+        const AssetPack *pack;
+        const AssetPackEntry *entry = find(normalized, pack);
+        if (!entry)
+            return false;
+        mtime = entry->mtime;
+        size = entry->size;
+        return true;
+    }
+
+    // relative to the working directory, with '/' separators and no "." or ".." components left.
+    static string Normalize(const string &path)
+    {
+        string text = path;
+        for (char &c : text)
+            if (c == '\\')
+                c = '/';
+        static const string workingDirectory = currentDirectory();
+        if (!workingDirectory.empty() && text.compare(0, workingDirectory.size(), workingDirectory) == 0
+            && text.size() > workingDirectory.size() && text[workingDirectory.size()] == '/')
+            text = text.substr(workingDirectory.size() + 1);
+        vector<string> parts;
+        size_t start = 0;
+        bool absolute = !text.empty() && text[0] == '/';
+        while (start <= text.size())
+        {
+            size_t end = text.find('/', start);
+            if (end == string::npos)
+                end = text.size();
+            string part = text.substr(start, end - start);
+            if (part == ".." && !parts.empty() && parts.back() != "..")
+                parts.pop_back();
+            else if (!part.empty() && part != ".")
+                parts.push_back(part);
+            start = end + 1;
+        }
+        string normalized = absolute ? "/" : "";
+        for (size_t i = 0; i < parts.size(); i++)
+            normalized += (i ? "/" : "") + parts[i];
+        return normalized;
+    }
+
+private:
+    vector<unique_ptr<AssetPack>> packs;
+
+    VirtualFileSystem() : looseFiles(true) {}
+
+    static string currentDirectory()
+    {
+        char buffer[4096];
+        return getcwd(buffer, sizeof(buffer)) ? string(buffer) : string();
+    }
+
+    const AssetPackEntry *find(const string &normalized, const AssetPack *&pack) const
+    {
+        for (const unique_ptr<AssetPack> &candidate : packs)
+            if (const AssetPackEntry *entry = candidate->find(normalized))
+            {
+                pack = candidate.get();
+                return entry;
+            }
+        return nullptr;
+    }
+
+    static bool openLoose(const string &path, VfsFile &file)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat info;
+        if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode))
+        {
+            ::close(fd);
+            return false;
+        }
+        file.length = (size_t)info.st_size;
+        if (file.length == 0)
+        {
+            ::close(fd);
+            file.bytes = "";
+            return true;
+        }
+        void *mapping = mmap(nullptr, file.length, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED)
+        {
+            file.length = 0;
+            return false;
+        }
+        // every consumer reads its file front to back
+        madvise(mapping, file.length, MADV_SEQUENTIAL);
+        file.mapping = mapping;
+        file.bytes = (const char *)mapping;
+        return true;
+    }
+};
+#endif
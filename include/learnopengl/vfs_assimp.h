@@ -0,0 +1,78 @@
+#ifndef VFS_ASSIMP_H
+#define VFS_ASSIMP_H
+
+#include <assimp/IOStream.hpp>
+#include <assimp/IOSystem.hpp>
+
+#include <learnopengl/vfs.h>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+using namespace std;
+
+// read-only Assimp stream over a file opened through the VirtualFileSystem.
+class VfsIOStream : public Assimp::IOStream
+{
+public:
+    explicit VfsIOStream(VfsFile file) : file(std::move(file)), position(0) {}
+
+    size_t Read(void *buffer, size_t size, size_t count) override
+    {
+        if (size == 0)
+            return 0;
+        count = std::min(count, (file.size() - position) / size);
+        memcpy(buffer, file.data() + position, size * count);
+        position += size * count;
+        return count;
+    }
+
+    size_t Write(const void *buffer, size_t size, size_t count) override { return 0; }
+
+    aiReturn Seek(size_t offset, aiOrigin origin) override
+    {
+        size_t target = origin == aiOrigin_SET ? offset : origin == aiOrigin_CUR ? position + offset : file.size() + offset;
+        if (target > file.size())
+            return aiReturn_FAILURE;
+        position = target;
+        return aiReturn_SUCCESS;
+    }
+
+    size_t Tell() const override { return position; }
+    size_t FileSize() const override { return file.size(); }
+    void Flush() override {}
+
+private:
+    VfsFile file;
+    size_t position;
+};
+
+// lets Assimp read a model and the files it references (material libraries, say) through the
+// VirtualFileSystem. Hand a new instance to Importer::SetIOHandler, the importer takes ownership. Given a vector,
+// every path opened is added to it once, so callers learn which files a model depends on.
+class VfsIOSystem : public Assimp::IOSystem
+{
+public:
+    explicit VfsIOSystem(vector<string> *opened = nullptr) : opened(opened) {}
+
+    bool Exists(const char *path) const override { return VirtualFileSystem::Instance().Exists(path); }
+
+    char getOsSeparator() const override { return '/'; }
+
+    Assimp::IOStream *Open(const char *path, const char *mode = "rb") override
+    {
+        if (strchr(mode, 'w') || strchr(mode, 'a') || strchr(mode, '+'))
+            return nullptr;
+        if (opened && find(opened->begin(), opened->end(), path) == opened->end())
+            opened->push_back(path);
+        VfsFile file = VirtualFileSystem::Instance().Open(path);
+        return file ? new VfsIOStream(std::move(file)) : nullptr;
+    }
+
+    void Close(Assimp::IOStream *stream) override { delete stream; }
+
+private:
+    vector<string> *opened;
+};
+#endif
@@ -16,8 +16,12 @@ struct PointLight {
 struct Material {
     sampler2D texture_diffuse1;
     sampler2D texture_specular1;
+};
 
+// parameters of the mesh's material, see material.h
+layout (std140) uniform MaterialBlock {
     float shininess;
+    float opacity;
 };
 
 in VS_OUT {
@@ -29,14 +33,22 @@ in VS_OUT {
 
 uniform Material material;
 
-uniform int num_of_lights;
-uniform PointLight pointLights[10];
-uniform vec3 viewPosition;
+// filled by PointLightBuffer (see light_buffer.h), shared with the shadow pass
+layout (std140) uniform PointLights {
+    PointLight pointLights[10];
+    int num_of_lights;
+};
 
 uniform samplerCube depthMaps[10];
 //uniform samplerCubeArray depthMaps;
-uniform float far_plane;
-uniform bool shadows;
+// per-frame camera and scene values, see frame_uniforms.h
+layout (std140) uniform Frame {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPosition;
+    float far_plane;
+    bool shadows;
+};
 
 vec3 gridSamplingDisk[20] = vec3[]
 (
@@ -108,10 +120,10 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, i
     float diff = max(dot(lightDir, normal), 0.0);
     // phong specular shading
     //vec3 reflectDir = reflect(-lightDir, normal);
-    //float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    //float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
     // bling-phong specular shading
     vec3 halfwayDir = normalize(lightDir + viewDir);
-    float spec = pow(max(dot(normal, halfwayDir), 0.0), 32.0);
+    float spec = pow(max(dot(normal, halfwayDir), 0.0), shininess);
 
     // attenuation
     float distance = length(light.position - fragPos);
@@ -147,5 +159,5 @@ void main()
         {
         }
     }
-    FragColor = vec4(result, 1.0);
+    FragColor = vec4(result, opacity);
 }
\ No newline at end of file
@@ -13,22 +13,45 @@ out VS_OUT {
 } vs_out;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// per-frame camera and scene values, see frame_uniforms.h
+layout (std140) uniform Frame {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPosition;
+    float far_plane;
+    bool shadows;
+};
 
 uniform bool reverse_normals;
 
+// quantized vertices (see vertex_format.h): positions relative to the mesh bounds
+uniform vec3 positionOffset;
+uniform float positionScale;
+// ... and octahedral encoded normals
+uniform bool quantizedNormals;
+
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
 void main()
 {
-    vs_out.FragPos = vec3(model * vec4(aPos, 1.0));
+    vec3 position = aPos * positionScale + positionOffset;
+    vec3 normal = quantizedNormals ? octDecode(aNormal.xy) : aNormal;
+    vs_out.FragPos = vec3(model * vec4(position, 1.0));
     if (reverse_normals)
     {
-        vs_out.Normal = transpose(inverse(mat3(model))) * (-1.0 * aNormal);
+        vs_out.Normal = transpose(inverse(mat3(model))) * (-1.0 * normal);
     }
     else
     {
-        vs_out.Normal = transpose(inverse(mat3(model))) * aNormal;
+        vs_out.Normal = transpose(inverse(mat3(model))) * normal;
     }
     vs_out.TexCoords = aTexCoords;
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    gl_Position = projection * view * model * vec4(position, 1.0);
 }
\ No newline at end of file
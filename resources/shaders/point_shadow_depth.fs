@@ -2,12 +2,38 @@
 
 in vec4 FragPos;
 
-uniform vec3 lightPos;
-uniform float far_plane;
+struct PointLight {
+    vec3 position;
+
+    vec3 specular;
+    vec3 diffuse;
+    vec3 ambient;
+
+    float constant;
+    float linear;
+    float quadratic;
+};
+
+// the lights of the lighting pass, see light_buffer.h
+layout (std140) uniform PointLights {
+    PointLight pointLights[10];
+    int num_of_lights;
+};
+
+// per-frame camera and scene values, see frame_uniforms.h
+layout (std140) uniform Frame {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPosition;
+    float far_plane;
+    bool shadows;
+};
+
+uniform int lightIndex;
 
 void main()
 {
-    float lightDistance = length(FragPos.xyz - lightPos);
+    float lightDistance = length(FragPos.xyz - pointLights[lightIndex].position);
     lightDistance = lightDistance / far_plane;
     gl_FragDepth = lightDistance;
 }
@@ -4,7 +4,11 @@ layout (location = 0) in vec3 aPos;
 
 uniform mat4 model;
 
+// quantized vertices (see vertex_format.h): positions relative to the mesh bounds
+uniform vec3 positionOffset;
+uniform float positionScale;
+
 void main()
 {
-    gl_Position = model * vec4(aPos, 1.0);
+    gl_Position = model * vec4(aPos * positionScale + positionOffset, 1.0);
 }
\ No newline at end of file
@@ -13,7 +13,15 @@
 #include <learnopengl/shader.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
+#include <learnopengl/frame_uniforms.h>
+#include <learnopengl/hot_reload.h>
+#include <learnopengl/light_buffer.h>
+#include <learnopengl/trace.h>
 
+#include <dirent.h>
+
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 
 void framebuffer_size_callback(GLFWwindow *window, int width, int height);
@@ -26,6 +34,8 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
 const unsigned int SCR_WIDTH = 1600;
 const unsigned int SCR_HEIGHT = 900;
 bool shadows = true;
+// resources/ bundled into one file, see asset_pack.h
+const char ASSET_PACK_PATH[] = "resources.pak";
 
 
 // camera
@@ -38,17 +48,6 @@ bool firstMouse = true;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
-struct PointLight {
-    glm::vec3 position;
-    glm::vec3 ambient;
-    glm::vec3 diffuse;
-    glm::vec3 specular;
-
-    float constant;
-    float linear;
-    float quadratic;
-};
-
 struct ProgramState {
     glm::vec3 clearColor = glm::vec3(0);
     bool ImGuiEnabled = false;
@@ -100,13 +99,59 @@ void ProgramState::LoadFromFile(std::string filename) {
 ProgramState *programState;
 
 unsigned int loadTexture(const char *path, bool b);
-void renderScene(Shader shader, std::vector<Model*> models);
+void renderScene(RenderQueue &queue, const Shader &shader, const std::vector<Model*> &models, const LodSelection &lod, bool depthOnly = false);
 void loadPointLights(std::vector<PointLight> *pointLights);
-void setPointLights(Shader shader, std::vector<PointLight> &pointLights);
+void benchmarkLoaders(const std::string &directory);
+void benchmarkImportProfiles(const std::string &directory);
+
+int main(int argc, char **argv) {
+    std::chrono::steady_clock::time_point startupStart = std::chrono::steady_clock::now();
+    Tracer::Instance().NameThread("main");
+    // --float-vertices uploads the full float vertex layout instead of the quantized one, for comparing the two
+    // --benchmark-loaders times the OBJ fast path against Assimp on every model under resources/objects and exits
+    // --texture-budget-mb <n> sets the VRAM budget of the texture residency manager
+    // --import-profile <name> imports the scene models with the given profile (see import_profile.h)
+    // --benchmark-import-profiles compares the import profiles on every model under resources/objects and exits
+    // --build-pack packs resources/ into resources.pak and exits
+    // --no-loose-files reads assets from resources.pak only; by default loose files override packed ones
+    // --trace <file> records the startup phases until full quality and writes them as a Chrome trace on exit
+    bool floatVertices = false;
+    std::string importProfile = DEFAULT_IMPORT_PROFILE;
+    std::string tracePath;
+    VirtualFileSystem::Instance().Mount(ASSET_PACK_PATH);
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::string(argv[i]) == "--build-pack")
+            return WriteAssetPack("resources", ASSET_PACK_PATH) ? 0 : 1;
+        if (std::string(argv[i]) == "--no-loose-files")
+            VirtualFileSystem::Instance().looseFiles = false;
+        if (std::string(argv[i]) == "--trace" && i + 1 < argc)
+        {
+            tracePath = argv[++i];
+            Tracer::Instance().enabled = true;
+        }
+        if (std::string(argv[i]) == "--float-vertices")
+            floatVertices = true;
+        if (std::string(argv[i]) == "--texture-budget-mb" && i + 1 < argc)
+            TextureResidency::Instance().budgetBytes = (size_t)atoi(argv[++i]) << 20;
+        if (std::string(argv[i]) == "--import-profile" && i + 1 < argc)
+            importProfile = FindImportProfile(argv[++i]).name;
+        if (std::string(argv[i]) == "--benchmark-loaders")
+        {
+            benchmarkLoaders("resources/objects");
+            return 0;
+        }
+        if (std::string(argv[i]) == "--benchmark-import-profiles")
+        {
+            benchmarkImportProfiles("resources/objects");
+            return 0;
+        }
+    }
 
-int main() {
+    TraceScope traceStartup("startup");
     // glfw: initialize and configure
     // ------------------------------
+    TraceScope traceGlfw("glfwInit");
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
@@ -116,8 +161,11 @@ int main() {
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
 
+    traceGlfw.End();
+
     // glfw window creation
     // --------------------
+    TraceScope traceWindow("glfwCreateWindow");
     GLFWwindow *window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
     if (window == NULL) {
         std::cout << "Failed to create GLFW window" << std::endl;
@@ -131,13 +179,17 @@ int main() {
     glfwSetKeyCallback(window, key_callback);
     // tell GLFW to capture our mouse
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    traceWindow.End();
 
     // glad: load all OpenGL function pointers
     // ---------------------------------------
+    TraceScope traceGlad("gladLoadGLLoader");
     if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
         std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    LoadGLExtensions((GLADloadproc) glfwGetProcAddress);
+    traceGlad.End();
 
     // tell stb_image.h to flip loaded texture's on the y-axis (before loading model).
     stbi_set_flip_vertically_on_load(true);
@@ -148,6 +200,7 @@ int main() {
         glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
     }
     // Init Imgui
+    TraceScope traceImGui("ImGui init");
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
     ImGuiIO &io = ImGui::GetIO();
@@ -158,24 +211,30 @@ int main() {
 
     ImGui_ImplGlfw_InitForOpenGL(window, true);
     ImGui_ImplOpenGL3_Init("#version 330 core");
+    traceImGui.End();
 
     // configure global opengl state
     // -----------------------------
     glEnable(GL_DEPTH_TEST);
-    glEnable(GL_BLEND);
+    // blending is enabled per draw, only for transparent materials (see render_queue.h)
     glEnable(GL_CULL_FACE);
     glCullFace(GL_BACK);
 
 
     // build and compile shaders
     // -------------------------
+    // the driver compiles all three while the framebuffers, models and shadow maps are set up below
+    TraceScope traceShaders("shaders");
+    ShaderBatch shaderBatch;
     //Shader ourShader("resources/shaders/2.model_lighting.vs", "resources/shaders/2.model_lighting.fs");
-    Shader ourShader("resources/shaders/model_lightning_expanded.vs", "resources/shaders/model_lightning_expanded.fs");
-    Shader simpleDepthShader("resources/shaders/point_shadow_depth.vs", "resources/shaders/point_shadow_depth.fs", "resources/shaders/point_shadow_depth.gs");
-    Shader aaShader("resources/shaders/aa.vs", "resources/shaders/aa.fs");
+    Shader ourShader(shaderBatch, "resources/shaders/model_lightning_expanded.vs", "resources/shaders/model_lightning_expanded.fs");
+    Shader simpleDepthShader(shaderBatch, "resources/shaders/point_shadow_depth.vs", "resources/shaders/point_shadow_depth.fs", "resources/shaders/point_shadow_depth.gs");
+    Shader aaShader(shaderBatch, "resources/shaders/aa.vs", "resources/shaders/aa.fs");
+    traceShaders.End();
 
 
     // custom AA ----------------------------------------------------------------------------
+    TraceScope traceFramebuffer("AA framebuffer");
     float quadVertices[] = {
             // positions   // texCoords
             -1.0f,  1.0f,  0.0f, 1.0f,
@@ -217,41 +276,44 @@ int main() {
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
         cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << endl;
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    traceFramebuffer.End();
 
     // ----------------------------------------------------------------------------
 
     // load models
     // ----------------------------------------------------------------------------
     stbi_set_flip_vertically_on_load(false);
+    // every model is imported concurrently on the loader pool while the render loop already runs; the models start
+    // out empty and the streamer uploads each one between frames once its import is done.
+    // the order matters, renderScene addresses the models by index.
+    ModelStreamer modelStreamer;
+    std::vector<std::unique_ptr<Model>> sceneModels = modelStreamer.Load({
+            {"resources/objects/zid/ZID.obj", importProfile},
+            {"resources/objects/pod/POD.obj", importProfile},
+            {"resources/objects/FORMCHAIR/LP_FORMCHAIR.obj", importProfile},
+            {"resources/objects/01STO/Sto.obj", importProfile},
+            {"resources/objects/02Lampa01/Lampa01.obj", importProfile},
+            {"resources/objects/01_Piksla/Piksla.obj", importProfile},
+            {"resources/objects/Lampa/old_table_lamp.obj", importProfile}
+    }, false, floatVertices ? VertexLayout::Float : VertexLayout::Quantized);
     std::vector<Model*> models;
-    Model wallModel("resources/objects/zid/ZID.obj");
-    wallModel.SetShaderTextureNamePrefix("material.");
-    models.push_back(&wallModel);
-    Model floorModel("resources/objects/pod/POD.obj");
-    floorModel.SetShaderTextureNamePrefix("material.");
-    models.push_back(&floorModel);
-    Model chairModel("resources/objects/FORMCHAIR/LP_FORMCHAIR.obj");
-    chairModel.SetShaderTextureNamePrefix("material.");
-    models.push_back(&chairModel);
-    Model tableModel("resources/objects/01STO/Sto.obj");
-    tableModel.SetShaderTextureNamePrefix("material.");
-    models.push_back(&tableModel);
-    Model lampModel("resources/objects/02Lampa01/Lampa01.obj");
-    lampModel.SetShaderTextureNamePrefix("material.");
-    models.push_back(&lampModel);
-    Model ashtrayModel("resources/objects/01_Piksla/Piksla.obj");
-    ashtrayModel.SetShaderTextureNamePrefix("material.");
-    models.push_back(&ashtrayModel);
-    Model lampV2Model("resources/objects/Lampa/old_table_lamp.obj");
-    lampV2Model.SetShaderTextureNamePrefix("material.");
-    models.push_back(&lampV2Model);
+    for (std::unique_ptr<Model> &model : sceneModels)
+    {
+        models.push_back(model.get());
+    }
 
     // setup lights
     // ----------------------------------------------------------------------------
     std::vector<PointLight> pointLights;
     loadPointLights(&pointLights);
+    // the lights live in a uniform buffer the lighting and shadow programs share; only changed lights are re-sent
+    PointLightBuffer lightBuffer;
+    lightBuffer.Create();
+    for (const PointLight &light : pointLights)
+        lightBuffer.Add(light);
     // ----------------------------------------------------------------------------
 
+    TraceScope traceShadowMaps("shadow cubemaps");
     const unsigned int SHADOW_WIDTH = 2048, SHADOW_HEIGHT = 2048;
     unsigned int depthMapFBOs[pointLights.size()];
     unsigned int depthCubemaps[pointLights.size()];
@@ -275,20 +337,67 @@ int main() {
         glReadBuffer(GL_NONE);
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
     }
+    traceShadowMaps.End();
 
     // draw in wireframe
     //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
     // render loop
     // -----------
+    shaderBatch.Finish();
+    // camera and scene uniforms every program reads, re-sent only when they change
+    FrameUniformBuffer frameUniforms;
+    frameUniforms.Create();
+    auto bindUniformBlocks = [](Shader &shader) {
+        PointLightBuffer::Bind(shader);
+        FrameUniformBuffer::Bind(shader);
+    };
+    // the lighting shader samples the mesh textures as material.texture_diffuse1 etc., see material.h
+    auto bindLightingProgram = [bindUniformBlocks](Shader &shader) {
+        bindUniformBlocks(shader);
+        BindMaterialSamplers(shader, "material.");
+    };
+    bindLightingProgram(ourShader);
+    bindUniformBlocks(simpleDepthShader);
     aaShader.use();
     aaShader.setInt("screenTexture", 24);
     aaShader.setInt("SCR_WIDTH", SCR_WIDTH);
     aaShader.setInt("SCR_HEIGHT", SCR_HEIGHT);
     ourShader.use();
     //ourShader.setInt("depthMap", 25);
+    bool firstFrameReported = false;
+    bool fullQualityReported = false;
+
+    // uniforms set every frame, by handle so the loop builds no names and looks up no locations
+    Uniform<glm::mat4> shadowMatrices[6];
+    for (unsigned int i = 0; i < 6; i++)
+        shadowMatrices[i] = Uniform<glm::mat4>("shadowMatrices[" + std::to_string(i) + "]");
+    std::vector<Uniform<int>> depthMaps;
+    for (unsigned int i = 0; i < lightBuffer.Size(); i++)
+        depthMaps.push_back(Uniform<int>("depthMaps[" + std::to_string(i) + "]"));
+    const Uniform<int> lightIndexUniform("lightIndex");
+    const Uniform<int> reverseNormalsUniform("reverse_normals");
+    // reused by every pass, so its storage is allocated once
+    RenderQueue renderQueue;
+
+    // edits under resources/shaders and resources/objects are picked up while running
+    TraceScope traceHotReload("HotReloader");
+    std::unique_ptr<HotReloader> hotReloader(new HotReloader(window));
+    hotReloader->Watch(ourShader, bindLightingProgram);
+    hotReloader->Watch(simpleDepthShader, bindUniformBlocks);
+    hotReloader->Watch(aaShader, [](Shader &shader) {
+        shader.use();
+        shader.setInt("screenTexture", 24);
+        shader.setInt("SCR_WIDTH", SCR_WIDTH);
+        shader.setInt("SCR_HEIGHT", SCR_HEIGHT);
+    });
+    for (Model *model : models)
+        hotReloader->Watch(*model);
+    traceHotReload.End();
+    traceStartup.End();
 
     while (!glfwWindowShouldClose(window)) {
+        TraceScope traceFrame("frame");
         // per-frame time logic
         // --------------------
         float currentFrame = glfwGetTime();
@@ -298,6 +407,27 @@ int main() {
         // input
         // -----
         processInput(window);
+
+        // swap in rebuilt shaders and models, upload models whose import finished, then stream in textures (their
+        // previews first) whose decode finished since the last frame
+        hotReloader->Update();
+        modelStreamer.Update();
+        TextureLoader::Instance().Update();
+        if (!fullQualityReported && modelStreamer.Idle() && TextureLoader::Instance().Idle() && TextureResidency::Instance().Idle())
+        {
+            std::cout << "STREAMING:: full quality after "
+                      << std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startupStart).count() << " ms" << std::endl;
+            TextureRegistry::Instance().Report();
+            TextureResidency::Instance().Report();
+            for (Model *model : models)
+            {
+                model->ReportTextureMemory();
+                model->ReportMemory();
+            }
+            fullQualityReported = true;
+            // the trace covers startup only
+            Tracer::Instance().enabled = false;
+        }
         // render
         // ------------------------------------------------------------------------------------------------
         glClearColor(programState->clearColor.r, programState->clearColor.g, programState->clearColor.b, 1.0f);
@@ -306,15 +436,29 @@ int main() {
         float near_plane = 1.0f;
         float far_plane = 25.0f;
         glm::mat4 shadowProj = glm::perspective(glm::radians(90.0f), (float)SHADOW_WIDTH / (float)SHADOW_HEIGHT, near_plane, far_plane);
-        for(int j = 0; j < pointLights.size(); ++j)
+        // shadow maps are blurry anyway, so the shadow pass draws one level coarser than its resolution asks for
+        LodSelection shadowLod;
+        shadowLod.pixelsPerUnit = SHADOW_HEIGHT / 2.0f; // 90 degree field of view
+        shadowLod.bias = 1;
+        // no GL calls unless a light, the camera or a setting changed since the last frame
+        lightBuffer.Upload();
+        FrameSettings frameSettings;
+        frameSettings.aspect = (float) SCR_WIDTH / (float) SCR_HEIGHT;
+        frameSettings.nearPlane = 0.1f;
+        frameSettings.farPlane = 100.0f;
+        frameSettings.shadowFarPlane = far_plane;
+        frameSettings.shadows = shadows;
+        frameUniforms.Update(programState->camera, frameSettings);
+        for(int j = 0; j < lightBuffer.Size(); ++j)
         {
+            const PointLight &light = lightBuffer.Get(j);
             std::vector<glm::mat4> shadowTransforms;
-            shadowTransforms.push_back(shadowProj * glm::lookAt(pointLights[j].position, pointLights[j].position + glm::vec3( 1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)));
-            shadowTransforms.push_back(shadowProj * glm::lookAt(pointLights[j].position, pointLights[j].position + glm::vec3(-1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)));
-            shadowTransforms.push_back(shadowProj * glm::lookAt(pointLights[j].position, pointLights[j].position + glm::vec3( 0.0f,  1.0f,  0.0f), glm::vec3(0.0f,  0.0f,  1.0f)));
-            shadowTransforms.push_back(shadowProj * glm::lookAt(pointLights[j].position, pointLights[j].position + glm::vec3( 0.0f, -1.0f,  0.0f), glm::vec3(0.0f,  0.0f, -1.0f)));
-            shadowTransforms.push_back(shadowProj * glm::lookAt(pointLights[j].position, pointLights[j].position + glm::vec3( 0.0f,  0.0f,  1.0f), glm::vec3(0.0f, -1.0f,  0.0f)));
-            shadowTransforms.push_back(shadowProj * glm::lookAt(pointLights[j].position, pointLights[j].position + glm::vec3( 0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f)));
+            shadowTransforms.push_back(shadowProj * glm::lookAt(light.position, light.position + glm::vec3( 1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)));
+            shadowTransforms.push_back(shadowProj * glm::lookAt(light.position, light.position + glm::vec3(-1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)));
+            shadowTransforms.push_back(shadowProj * glm::lookAt(light.position, light.position + glm::vec3( 0.0f,  1.0f,  0.0f), glm::vec3(0.0f,  0.0f,  1.0f)));
+            shadowTransforms.push_back(shadowProj * glm::lookAt(light.position, light.position + glm::vec3( 0.0f, -1.0f,  0.0f), glm::vec3(0.0f,  0.0f, -1.0f)));
+            shadowTransforms.push_back(shadowProj * glm::lookAt(light.position, light.position + glm::vec3( 0.0f,  0.0f,  1.0f), glm::vec3(0.0f, -1.0f,  0.0f)));
+            shadowTransforms.push_back(shadowProj * glm::lookAt(light.position, light.position + glm::vec3( 0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f)));
 
             glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
             glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBOs[j]);
@@ -322,12 +466,12 @@ int main() {
             simpleDepthShader.use();
             for(unsigned int i = 0; i < 6; ++i)
             {
-                simpleDepthShader.setMat4("shadowMatrices[" + std::to_string(i) + "]", shadowTransforms[i]);
+                simpleDepthShader.set(shadowMatrices[i], shadowTransforms[i]);
             }
-            simpleDepthShader.setFloat("far_plane", far_plane);
-            simpleDepthShader.setVec3("lightPos", pointLights[j].position);
+            simpleDepthShader.set(lightIndexUniform, j);
             glDisable(GL_CULL_FACE);
-            renderScene(simpleDepthShader, models);
+            shadowLod.viewPosition = light.position;
+            renderScene(renderQueue, simpleDepthShader, models, shadowLod, true);
 
             glBindFramebuffer(GL_FRAMEBUFFER, 0);
         }
@@ -344,26 +488,17 @@ int main() {
 
         // don't forget to enable shader before setting uniforms
         ourShader.use();
-        setPointLights(ourShader, pointLights);
-        ourShader.setVec3("viewPosition", programState->camera.Position);
-        // view/projection transformations
-        glm::mat4 projection = glm::perspective(glm::radians(programState->camera.Zoom),
-                                                (float) SCR_WIDTH / (float) SCR_HEIGHT, 0.1f, 100.0f);
-        glm::mat4 view = programState->camera.GetViewMatrix();
-        ourShader.setMat4("projection", projection);
-        ourShader.setMat4("view", view);
-
-        ourShader.setInt("shadows", shadows);
-        ourShader.setInt("num_of_lights", pointLights.size());
-        ourShader.setFloat("far_plane", far_plane);
-        ourShader.setInt("reverse_normals", 0);
-        for(int i = 0; i < pointLights.size(); ++i)
+        ourShader.set(reverseNormalsUniform, 0);
+        for(int i = 0; i < lightBuffer.Size(); ++i)
         {
-            ourShader.setInt("depthMaps[" + std::to_string(i) + "]", 10 + i);
+            ourShader.set(depthMaps[i], 10 + i);
             glActiveTexture(GL_TEXTURE10 + i);
             glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubemaps[i]);
         }
-        renderScene(ourShader, models);
+        LodSelection cameraLod;
+        cameraLod.viewPosition = programState->camera.Position;
+        cameraLod.pixelsPerUnit = SCR_HEIGHT / (2.0f * tanf(glm::radians(programState->camera.Zoom) / 2.0f));
+        renderScene(renderQueue, ourShader, models, cameraLod);
 
         // ------------------------------------------------------------------------------------------------
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -387,75 +522,87 @@ int main() {
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
+        // every draw has reported the texture levels it needs, stream towards them within the budget
+        TextureResidency::Instance().Update();
+
         glfwSwapBuffers(window);
         glfwPollEvents();
+        if (!firstFrameReported)
+        {
+            std::cout << "STREAMING:: first frame after "
+                      << std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startupStart).count() << " ms" << std::endl;
+            firstFrameReported = true;
+        }
     }
 
     programState->SaveToFile("resources/program_state.txt");
     delete programState;
+    // models release their textures, which needs the context to still be alive
+    hotReloader.reset();
+    models.clear();
+    sceneModels.clear();
+    lightBuffer.Release();
+    frameUniforms.Release();
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
     glfwTerminate();
+    if (!tracePath.empty())
+        Tracer::Instance().Write(tracePath);
     return 0;
 }
 
-void renderScene(Shader shader, std::vector<Model*> models)
+// queues the scene and draws it sorted, see render_queue.h
+void renderScene(RenderQueue &queue, const Shader &shader, const std::vector<Model*> &models, const LodSelection &lod, bool depthOnly)
 {
+    queue.Clear();
     glm::mat4 model = glm::mat4(1.0f);
     model = glm::translate(model, glm::vec3(0.5f, 0.3f, 0.5f));
     model = glm::scale(model, glm::vec3(0.5));
-    shader.setMat4("model", model);
-    models[0]->Draw(shader);
+    models[0]->Enqueue(queue, shader, model, lod, depthOnly);
 
     model = glm::mat4(1.0f);
     model = glm::translate(model, glm::vec3(0.5f, 0.3f, 0.5f));
     model = glm::scale(model, glm::vec3(0.5));
-    shader.setMat4("model", model);
-    models[1]->Draw(shader);
+    models[1]->Enqueue(queue, shader, model, lod, depthOnly);
 
     model = glm::mat4(1.0f);
     model = glm::translate(model, glm::vec3(-3.0f, 0.32f, -3.0f));
     model = glm::rotate(model, 45.0f, glm::vec3(0.0f, 1.0f, 0.0f));
     model = glm::scale(model, glm::vec3(2.9));
-    shader.setMat4("model", model);
-    models[2]->Draw(shader);
+    models[2]->Enqueue(queue, shader, model, lod, depthOnly);
 
     model = glm::mat4(1.0f);
     model = glm::translate(model, glm::vec3(5.0f, 0.32f, -2.0f));
     model = glm::rotate(model, -14.0f, glm::vec3(0.0f, 1.0f, 0.0f));
     model = glm::scale(model, glm::vec3(2.9));
-    shader.setMat4("model", model);
-    models[2]->Draw(shader);
+    models[2]->Enqueue(queue, shader, model, lod, depthOnly);
 
     model = glm::mat4(1.0f);
     model = glm::translate(model, glm::vec3(1.5f, 1.35f, 1.5f));
     model = glm::rotate(model, -19.0f, glm::vec3(0.0f, 1.0f, 0.0f));
     model = glm::scale(model, glm::vec3(1.0));
-    shader.setMat4("model", model);
-    models[3]->Draw(shader);
+    models[3]->Enqueue(queue, shader, model, lod, depthOnly);
 
     model = glm::mat4(1.0f);
     model = glm::translate(model, glm::vec3(1.5f, 16.0f, 1.5f));
     model = glm::rotate(model, -45.0f, glm::vec3(0.0f, 1.0f, 0.0f));
     model = glm::scale(model, glm::vec3(0.05f));
-    shader.setMat4("model", model);
-    models[4]->Draw(shader);
+    models[4]->Enqueue(queue, shader, model, lod, depthOnly);
 
     model = glm::mat4(1.0f);
     model = glm::translate(model, glm::vec3(1.5f, 3.03f, 1.5f));
     model = glm::scale(model, glm::vec3(0.04));
-    shader.setMat4("model", model);
-    models[5]->Draw(shader);
+    models[5]->Enqueue(queue, shader, model, lod, depthOnly);
 
 
     model = glm::mat4(1.0f);
     model = glm::translate(model, glm::vec3(1.9f, 3.03f, -2.5f));
     model = glm::scale(model, glm::vec3(0.05));
-    shader.setMat4("model", model);
-    models[6]->Draw(shader);
+    models[6]->Enqueue(queue, shader, model, lod, depthOnly);
+    queue.Submit();
 }
 
 void loadPointLights(std::vector<PointLight> *pointLights)
@@ -486,21 +633,6 @@ void loadPointLights(std::vector<PointLight> *pointLights)
 
 }
 
-void setPointLights(Shader shader, std::vector<PointLight> &pointLights)
-{
-    shader.use();
-    for(int i = 0; i < pointLights.size(); ++i)
-    {
-        shader.setVec3("pointLights[" + std::to_string(i) + "].position", pointLights[i].position);
-        shader.setVec3("pointLights[" + std::to_string(i) + "].ambient", pointLights[i].ambient);
-        shader.setVec3("pointLights[" + std::to_string(i) + "].diffuse", pointLights[i].diffuse);
-        shader.setVec3("pointLights[" + std::to_string(i) + "].specular", pointLights[i].specular);
-        shader.setFloat("pointLights[" + std::to_string(i) + "].constant", pointLights[i].constant);
-        shader.setFloat("pointLights[" + std::to_string(i) + "].linear", pointLights[i].linear);
-        shader.setFloat("pointLights[" + std::to_string(i) + "].quadratic", pointLights[i].quadratic);
-    }
-}
-
 // process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
 // ---------------------------------------------------------------------------------------------------------
 void processInput(GLFWwindow *window) {
@@ -586,6 +718,8 @@ void DrawImGui(ProgramState *programState) {
 }
 
 void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods) {
+    if (key == GLFW_KEY_F2 && action == GLFW_PRESS)
+        TextureResidency::Instance().Report();
     if (key == GLFW_KEY_F1 && action == GLFW_PRESS) {
         programState->ImGuiEnabled = !programState->ImGuiEnabled;
         if (programState->ImGuiEnabled) {
@@ -596,3 +730,105 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
         }
     }
 }
+
+static void findObjFiles(const std::string &directory, std::vector<std::string> &files)
+{
+    DIR *dir = opendir(directory.c_str());
+    if (!dir)
+        return;
+    while (dirent *entry = readdir(dir))
+    {
+        std::string name = entry->d_name;
+        if (name == "." || name == "..")
+            continue;
+        std::string path = directory + '/' + name;
+        if (entry->d_type == DT_DIR)
+            findObjFiles(path, files);
+        else if (name.size() > 4 && name.substr(name.size() - 4) == ".obj")
+            files.push_back(path);
+    }
+    closedir(dir);
+    std::sort(files.begin(), files.end());
+}
+
+// parses every OBJ file with both importers (best of a few runs each, no mesh cache involved) and checks
+// that they agree.
+void benchmarkLoaders(const std::string &directory)
+{
+    const int runs = 5;
+    std::vector<std::string> files;
+    findObjFiles(directory, files);
+    float totalAssimp = 0.0f, totalObj = 0.0f;
+    for (const std::string &file : files)
+    {
+        std::vector<MeshData> assimpMeshes, objMeshes;
+        float assimpMs = 1e30f, objMs = 1e30f;
+        for (int run = 0; run < runs; run++)
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            assimpMeshes.clear();
+            Model::ImportWithAssimp(file, assimpMeshes);
+            std::chrono::steady_clock::time_point middle = std::chrono::steady_clock::now();
+            objMeshes.clear();
+            bool parsed = LoadObj(file, objMeshes);
+            std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+            assimpMs = std::min(assimpMs, std::chrono::duration<float, std::milli>(middle - start).count());
+            objMs = std::min(objMs, std::chrono::duration<float, std::milli>(end - middle).count());
+            if (!parsed)
+                break;
+        }
+        // Assimp emits one vertex per face corner, weld both sides before comparing the vertex sets
+        for (MeshData &mesh : assimpMeshes)
+            WeldVertices(mesh.vertices, mesh.indices);
+        std::string difference = CompareMeshData(objMeshes, assimpMeshes);
+        totalAssimp += assimpMs;
+        totalObj += objMs;
+        std::cout << "LOADER::BENCHMARK:: " << file << ": assimp " << assimpMs << " ms, obj " << objMs << " ms ("
+                  << assimpMs / objMs << "x), " << (difference.empty() ? "identical meshes" : "MISMATCH " + difference) << std::endl;
+    }
+    std::cout << "LOADER::BENCHMARK:: " << files.size() << " files: assimp " << totalAssimp << " ms, obj " << totalObj << " ms ("
+              << totalAssimp / totalObj << "x) on " << ThreadPool::Loaders().Size() << " loader threads" << std::endl;
+}
+
+// imports every OBJ file with each import profile (best of a few runs, mesh cache bypassed) and prints the
+// import time next to what the result costs at draw time: draw calls, vertices and indices.
+void benchmarkImportProfiles(const std::string &directory)
+{
+    const int runs = 3;
+    std::vector<std::string> files;
+    findObjFiles(directory, files);
+    for (const ImportProfile &profile : IMPORT_PROFILES)
+    {
+        float totalMs = 0.0f;
+        size_t totalMeshes = 0, totalVertices = 0, totalIndices = 0;
+        for (const std::string &file : files)
+        {
+            float importMs = 1e30f;
+            size_t vertices = 0, indices = 0, meshes = 0;
+            for (int run = 0; run < runs; run++)
+            {
+                ModelData data = Model::Import(file, profile, MeshCacheMode::Bypass);
+                if (!data.loaded)
+                    break;
+                importMs = std::min(importMs, data.importMilliseconds);
+                meshes = data.meshes.size();
+                vertices = indices = 0;
+                for (const MeshData &mesh : data.meshes)
+                {
+                    vertices += mesh.vertices.size();
+                    indices += mesh.lods.empty() ? mesh.indices.size() : mesh.lods[0].indexCount;
+                }
+            }
+            if (meshes == 0)
+                continue;
+            totalMs += importMs;
+            totalMeshes += meshes;
+            totalVertices += vertices;
+            totalIndices += indices;
+            std::cout << "IMPORT::BENCHMARK:: [" << profile.name << "] " << file << ": " << importMs << " ms, " << meshes
+                      << " draw calls, " << vertices << " vertices, " << indices << " indices" << std::endl;
+        }
+        std::cout << "IMPORT::BENCHMARK:: [" << profile.name << "] " << files.size() << " files: " << totalMs << " ms, "
+                  << totalMeshes << " draw calls, " << totalVertices << " vertices, " << totalIndices << " indices" << std::endl;
+    }
+}